@@ -0,0 +1,76 @@
+# Generate ../src/aot_table.h, C translations of the ROMs that run fast
+# enough to gain from it, with ch8toec8 -a. Tickrates from chip8.txt.
+# Each translation is timed with aotbench against the interpreter, only
+# those measured at least AOT_MIN_SPEEDUP times faster are kept.
+import os
+import re
+import subprocess
+
+AOT_TICKRATE = 100      # and up
+AOT_MIN_SPEEDUP = 1.1
+AOT_FRAMES = 600        # benchmarked
+
+def rom(name):
+    for path in (f"chip8Archive/roms/{name}.ch8", f"ec8/{name}.ec8"):
+        if os.path.exists(path):
+            return path
+    return None
+
+def write(translations):
+    with open('../src/aot_table.h', 'w') as out:
+        out.write("// Generated by fs/aot.py with ch8toec8 -a, don't edit\n")
+        for h, (name, size, runs, code, path) in sorted(translations.items()):
+            out.write("\n" + code)
+        out.write("\nstatic const aot_entry aot_table[] = {\n")
+        for h, (name, size, runs, code, path) in sorted(translations.items()):
+            out.write(f"  {{ 0x{h:08X}, {size}, {runs}, aot_{name}_runs, aot_{name} }},\n")
+        out.write("};\n")
+
+# the speed-up of the translation of path, None if it doesn't end the same
+def speedup(path):
+    out = subprocess.run(['./aotbench', '-f', str(AOT_FRAMES), path],
+                         capture_output=True, text=True).stdout
+    m = re.search(r'([\d.]+)x(  DIFFERS.*)?$', out.splitlines()[0]) if out else None
+    if m is None or m.group(2):
+        return None
+    return float(m.group(1))
+
+translations = {}
+for line in open('chip8.txt'):
+    f = line.strip().split(',')
+    if len(f) != 8 or int(f[1]) < AOT_TICKRATE:
+        continue
+    path = rom(f[0])
+    if path is None:
+        print(f"no ROM for {f[0]}")
+        continue
+    code = subprocess.run(['./ch8toec8', '-a', path], check=True,
+                          capture_output=True, text=True).stdout
+    lines = code.splitlines()
+    name, h, size = lines[0].split()[1:4]
+    runs, blocks = int(lines[-1].split()[1]), int(lines[-1].split()[3])
+    if not blocks:
+        print(f"nothing to translate in {f[0]}")
+        continue
+    if int(h, 16) in translations:
+        print(f"{f[0]} has the same contents as {translations[int(h, 16)][0]}")
+        continue
+    translations[int(h, 16)] = (name, int(size), runs, code, path)
+
+# all of them first, for aotbench to time
+write(translations)
+subprocess.run(['make', '-s', 'aotbench'], check=True)
+
+fast = {}
+for h, t in sorted(translations.items(), key=lambda t: t[1][0]):
+    gain = speedup(t[4])
+    if gain is None:
+        print(f"{t[0]}: differs from the interpreter, left out")
+    elif gain < AOT_MIN_SPEEDUP:
+        print(f"{t[0]}: {gain:.2f}x, left out")
+    else:
+        print(f"{t[0]}: {gain:.2f}x")
+        fast[h] = t
+
+write(fast)
+print(f"{len(fast)} of {len(translations)} ROMs")
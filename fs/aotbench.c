@@ -0,0 +1,154 @@
+/**
+ * Benchmark of the translated ROMs in ../src/aot_table.h.
+ * Each ROM given that has a translation runs for a number of frames in
+ * the interpreter and translated side by side, from the same start with
+ * the same input and random numbers. Both have to be in the same state
+ * after every frame, the first frame that differs ends the ROM's run; the
+ * times are reported per ROM and in total.
+ *
+ * Usage: aotbench [-f frames] [-t tickrate] rom.ec8|rom.ch8...
+ * -t runs all ROMs at tickrate instead of their own.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the core's random numbers, each run has its own from the same start */
+#define SEED 0x2545F491
+static uint32_t seed;
+static int
+bench_rand(void)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed & 0x7FFFFFFF;
+}
+#define rand bench_rand
+#include "../vendor/c-octo/src/octo_emulator.h"
+#undef rand
+
+#include "../src/aot_runtime.h"
+#include "headless.h"
+
+static octo_emulator interpreted, translated;
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* each key tapped in turn, one per second */
+static void
+input(octo_emulator* emu, int frame)
+{
+  memset(emu->keys, 0, sizeof(emu->keys));
+  if (frame % 60 < 6) {
+    emu->keys[frame / 60 % 16] = 1;
+  }
+}
+
+/*
+ * Runs both for frames of the same loop as the device's emu_step() and
+ * adds up their seconds in t0 and t1; the first frame after which they
+ * differ, -1 if none
+ */
+static int
+bench(int frames, double* t0, double* t1)
+{
+  uint32_t seeds[2] = { SEED, SEED };
+  double start;
+  int frame;
+
+  *t0 = *t1 = 0;
+  for (frame = 0; frame < frames && !interpreted.halt && !translated.halt; frame++) {
+    input(&interpreted, frame);
+    seed = seeds[0];
+    start = now();
+    headless_frame(&interpreted);
+    *t0 += now() - start;
+    seeds[0] = seed;
+
+    input(&translated, frame);
+    seed = seeds[1];
+    start = now();
+    aot_step(&translated, translated.options.tickrate);
+    headless_timers(&translated);
+    *t1 += now() - start;
+    seeds[1] = seed;
+
+    if (memcmp(&interpreted, &translated, sizeof(octo_emulator)) != 0) {
+      return frame;
+    }
+  }
+  return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int opt, n, size, frames = 3600, tickrate = 0, count = 0, differ = 0, at;
+  double slow = 0, fast = 0, t0, t1;
+  octo_options options;
+  uint8_t* rom;
+
+  while ((opt = getopt(argc, argv, "f:t:")) != -1) {
+    if (opt == 'f') {
+      frames = atoi(optarg);
+    }
+    else
+    if (opt == 't') {
+      tickrate = atoi(optarg);
+    }
+    else {
+      optind = argc;
+      break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "Usage: %s [-f frames] [-t tickrate] rom.ec8|rom.ch8...\n", argv[0]);
+    return 1;
+  }
+
+  for (n = optind; n < argc; n++) {
+    const char* base = strrchr(argv[n], '/') ? strrchr(argv[n], '/') + 1 : argv[n];
+
+    rom = headless_read(argv[n], &options, &size);
+    if (rom == NULL) {
+      fprintf(stderr, "Error: Could not read file %s\n", argv[n]);
+      continue;
+    }
+    if (!aot_use(romdb_hash(rom, size), rom, size)) {
+      free(rom);
+      continue;
+    }
+    if (tickrate) {
+      options.tickrate = tickrate;
+    }
+    octo_emulator_init(&interpreted, (char*)rom, size, &options, NULL);
+    octo_emulator_init(&translated, (char*)rom, size, &options, NULL);
+    at = bench(frames, &t0, &t1);
+
+    count++;
+    slow += t0;
+    fast += t1;
+    printf("%-24.*s %8.1f ms %8.1f ms  %5.2fx", (int)(strchr(base, '.') ? strchr(base, '.') - base : (int)strlen(base)),
+      base, t0 * 1000, t1 * 1000, t1 > 0 ? t0 / t1 : 0);
+    if (at >= 0) {
+      differ++;
+      printf("  DIFFERS after frame %d", at);
+    }
+    printf("\n");
+    free(rom);
+  }
+  printf("%d ROMs, %d differ, interpreted %.1f ms, translated %.1f ms, %.2fx\n",
+    count, differ, slow * 1000, fast * 1000, fast > 0 ? slow / fast : 0);
+  return differ != 0;
+}
@@ -2,11 +2,329 @@
  * Convert a .ch8 file to a .ec8 file.
  * .ec8 files are used by the emulator. They contain an octo_option structure,
  * followed by the raw data of the .ch8 file. 
+ *
+ * With -a, translate the code of a .ch8 or .ec8 to C instead and write it
+ * to stdout, see aot.py.
  */
 #include <stdio.h>
 #include <libgen.h>
 #include <string.h>
+#include <ctype.h>
 #include "../vendor/c-octo/src/octo_emulator.h"
+#include "../src/flow.h"
+
+/*
+ * Ahead-of-time translation.
+ *
+ * The code reachable from 0x200 is found by ../src/flow.cpp, the analysis
+ * of the device's disassembler (linked in as flow.o). Runs of register,
+ * jump and skip instructions become C blocks in a switch on pc; anything
+ * else is left to the interpreter (aot_one()), which falls back into the
+ * switch at the next block. A block starts where control can arrive other
+ * than from the instruction before. It runs only if it fits into what's
+ * left of the frame, so the instruction count per frame is the
+ * interpreter's. Waiting for a key in FX0A is left to the interpreter as
+ * well, key tests go through aot_key() so the runtime sees them.
+ *
+ * The bytes a translation depends on are listed as runs. The runtime
+ * compares them with the ROM and stops using the blocks of a run that
+ * the program rewrote.
+ */
+
+#define LEADER 1        /* a block starts here */
+#define CODE 2          /* a translation depends on it */
+
+enum { PLAIN, SKIP, JUMP, OTHER };
+
+static unsigned char ram[65536 + 4];
+static unsigned char marks[65536 + 8];    /* a skip marks up to 6 past it */
+static int runOf[65536];
+
+static int
+opAt(int a)
+{
+  return ram[a] << 8 | ram[a + 1];
+}
+
+/* of the instruction a skip at a - 2 passes over */
+static int
+length(int a)
+{
+  return opAt(a) == 0xF000 ? 4 : 2;
+}
+
+static int
+kind(int op)
+{
+  int n = op & 0xF, nn = op & 0xFF;
+
+  switch (op >> 12) {
+    case 0x1:
+      return JUMP;
+    case 0x3:
+    case 0x4:
+      return SKIP;
+    case 0x5:
+    case 0x9:
+      return n == 0 ? SKIP : OTHER;
+    case 0xE:
+      return nn == 0x9E || nn == 0xA1 ? SKIP : OTHER;
+    case 0x6:
+    case 0x7:
+    case 0xA:
+      return PLAIN;
+    case 0x8:
+      return n <= 7 || n == 0xE ? PLAIN : OTHER;
+    case 0xF:
+      return op != 0xF000 && (nn == 0x07 || nn == 0x15) ? PLAIN : OTHER;
+  }
+  return OTHER;
+}
+
+/* the entry, the targets of jumps and calls, and what follows anything else */
+static void
+leaders(int end)
+{
+  int a;
+
+  for (a = 0x200; a < end - 1; a++) {
+    if (!flow_is_code(a)) {
+      continue;
+    }
+    if (a == 0x200 || flow_is_target(a)) {
+      marks[a] |= LEADER;
+    }
+    if (kind(opAt(a)) != PLAIN) {
+      marks[a + (opAt(a) == 0xF000 ? 4 : 2)] |= LEADER;
+      if (kind(opAt(a)) == SKIP) {
+        marks[a + 2 + length(a + 2)] |= LEADER;
+      }
+    }
+  }
+}
+
+/* the instructions of the block at a, its end in *next */
+static int
+block(int a, int end, int* next)
+{
+  int n = 0, k;
+
+  for (*next = a; *next < end - 1 && flow_is_code(*next); ) {
+    k = kind(opAt(*next));
+    if (k == OTHER || (n && (marks[*next] & LEADER))) {
+      break;
+    }
+    n++;
+    *next += 2;
+    if (k != PLAIN) {
+      break;
+    }
+  }
+  return n;
+}
+
+static void
+statement(int a)
+{
+  int op = opAt(a), x = op >> 8 & 0xF, y = op >> 4 & 0xF, nn = op & 0xFF;
+  const char* logic = " if (emu->options.q_logic) v[0xF] = 0;";
+
+  switch (op >> 12) {
+    case 0x6:
+      printf("      v[0x%X] = 0x%02X;\n", x, nn);
+      return;
+    case 0x7:
+      printf("      v[0x%X] += 0x%02X;\n", x, nn);
+      return;
+    case 0xA:
+      printf("      emu->i = 0x%03X;\n", op & 0xFFF);
+      return;
+    case 0xF:
+      if (nn == 0x07) {
+        printf("      v[0x%X] = emu->dt;\n", x);
+      }
+      else {
+        printf("      emu->dt = v[0x%X];\n", x);
+      }
+      return;
+  }
+  switch (op & 0xF) {
+    case 0x0:
+      printf("      v[0x%X] = v[0x%X];\n", x, y);
+      return;
+    case 0x1:
+      printf("      v[0x%X] |= v[0x%X];%s\n", x, y, logic);
+      return;
+    case 0x2:
+      printf("      v[0x%X] &= v[0x%X];%s\n", x, y, logic);
+      return;
+    case 0x3:
+      printf("      v[0x%X] ^= v[0x%X];%s\n", x, y, logic);
+      return;
+    case 0x4:
+      printf("      { int t = v[0x%X] + v[0x%X]; v[0x%X] = t; v[0xF] = t >> 8; }\n", x, y, x);
+      return;
+    case 0x5:
+      printf("      { int t = v[0x%X] >= v[0x%X]; v[0x%X] -= v[0x%X]; v[0xF] = t; }\n", x, y, x, y);
+      return;
+    case 0x7:
+      printf("      { int t = v[0x%X] >= v[0x%X]; v[0x%X] = v[0x%X] - v[0x%X]; v[0xF] = t; }\n", y, x, x, y, x);
+      return;
+    case 0x6:
+      printf("      { int t = emu->options.q_shift ? v[0x%X] : v[0x%X]; v[0x%X] = t >> 1; v[0xF] = t & 1; }\n", x, y, x);
+      return;
+    case 0xE:
+      printf("      { int t = emu->options.q_shift ? v[0x%X] : v[0x%X]; v[0x%X] = t << 1; v[0xF] = t >> 7; }\n", x, y, x);
+      return;
+  }
+}
+
+static void
+ending(int a)
+{
+  int op = opAt(a), x = op >> 8 & 0xF, y = op >> 4 & 0xF, nn = op & 0xFF;
+  int skip = a + 2 + length(a + 2);
+
+  switch (op >> 12) {
+    case 0x1:
+      printf("emu->pc = 0x%03X;", op & 0xFFF);
+      return;
+    case 0x3:
+      printf("emu->pc = v[0x%X] == 0x%02X ? 0x%03X : 0x%03X;", x, nn, skip, a + 2);
+      return;
+    case 0x4:
+      printf("emu->pc = v[0x%X] != 0x%02X ? 0x%03X : 0x%03X;", x, nn, skip, a + 2);
+      return;
+    case 0x5:
+      if (x == y) {
+        printf("emu->pc = 0x%03X;", skip);
+      }
+      else {
+        printf("emu->pc = v[0x%X] == v[0x%X] ? 0x%03X : 0x%03X;", x, y, skip, a + 2);
+      }
+      return;
+    case 0xE:
+      printf("emu->pc = %saot_key(emu, v[0x%X]) ? 0x%03X : 0x%03X;", nn == 0x9E ? "" : "!", x, skip, a + 2);
+      return;
+    case 0x9:
+      if (x == y) {
+        printf("emu->pc = 0x%03X;", a + 2);
+      }
+      else {
+        printf("emu->pc = v[0x%X] != v[0x%X] ? 0x%03X : 0x%03X;", x, y, skip, a + 2);
+      }
+      return;
+  }
+}
+
+static unsigned
+fnv1a(const unsigned char* p, int size)
+{
+  unsigned h = 0x811C9DC5;
+  int n;
+
+  for (n = 0; n < size; n++) {
+    h = (h ^ p[n]) * 0x01000193;
+  }
+  return h;
+}
+
+static int
+aot(const char* path)
+{
+  FILE* f;
+  char name[64];
+  const char *p, *base;
+  int head, size, end, a, b, next, n, runs, blocks, translated, instructions;
+
+  p = path + strlen(path) - 4;
+  head = strcmp(p, ".ec8") == 0 ? sizeof(octo_options) : 0;
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Error: Could not read file %s\n", path);
+    return 1;
+  }
+  fseek(f, head, SEEK_SET);
+  size = fread(ram + 0x200, 1, sizeof(ram) - 4 - 0x200, f);
+  fclose(f);
+  end = 0x200 + size;
+
+  base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  for (n = 0; base + n < p && n < (int)sizeof(name) - 1; n++) {
+    name[n] = isalnum((unsigned char)base[n]) ? base[n] : '_';
+  }
+  name[n] = '\0';
+
+  if (!flow_analyse(ram, 0x200, end)) {
+    fprintf(stderr, "Error: No memory for flow analysis of %s\n", path);
+    return 1;
+  }
+  leaders(end);
+
+  /* the bytes translated, and the opcode a skip looks at */
+  blocks = translated = instructions = 0;
+  for (a = 0x200; a < end - 1; a++) {
+    instructions += flow_is_code(a);
+    if (flow_is_code(a) && kind(opAt(a)) != OTHER) {
+      marks[a] |= CODE;
+      marks[a + 1] |= CODE;
+      if (kind(opAt(a)) == SKIP) {
+        marks[a + 2] |= CODE;
+        marks[a + 3] |= CODE;
+      }
+    }
+  }
+
+  printf("// %s 0x%08X %d\n", name, fnv1a(ram + 0x200, size), size);
+  printf("static const uint16_t aot_%s_runs[] = {", name);
+  runs = 0;
+  for (a = 0x200; a < end; a++) {
+    if ((marks[a] & CODE) && !(marks[a - 1] & CODE)) {
+      for (b = a; b < end && (marks[b] & CODE); b++) {
+        runOf[b] = runs;
+      }
+      printf("%s0x%04X, 0x%04X,", runs % 4 ? " " : "\n  ", a, b);
+      runs++;
+    }
+  }
+  printf("\n};\n\n");
+
+  printf("static int aot_%s(octo_emulator* emu, int cycles, const uint8_t* stale) {\n", name);
+  printf("  uint8_t* v = emu->v;\n");
+  printf("  int z = 0;\n");
+  printf("  while (z < cycles && !emu->halt) {\n");
+  printf("    switch (emu->wait ? 0 : emu->pc) {\n");
+  for (a = 0x200; a < end - 1; a++) {
+    if (!(marks[a] & LEADER) || !flow_is_code(a) || !(n = block(a, end, &next))) {
+      continue;
+    }
+    blocks++;
+    translated += n;
+    printf("    case 0x%03X:\n", a);
+    printf("      if (cycles - z < %d || stale[%d]) break;\n", n, runOf[a]);
+    for (b = a; b < next; b += 2) {
+      if (kind(opAt(b)) == PLAIN) {
+        statement(b);
+      }
+    }
+    printf("      z += %d; ", n);
+    if (kind(opAt(next - 2)) == PLAIN) {
+      printf("emu->pc = 0x%03X;", next);
+    }
+    else {
+      ending(next - 2);
+    }
+    printf(" continue;\n");
+  }
+  printf("    }\n");
+  printf("    z++;\n");
+  printf("    if (aot_one(emu)) break;\n");
+  printf("  }\n");
+  printf("  return z;\n");
+  printf("}\n");
+  printf("// %d runs, %d blocks, %d of %d instructions\n", runs, blocks, translated, instructions);
+  return 0;
+}
 
 int
 main(int argc, char *argv[])
@@ -17,8 +335,12 @@ main(int argc, char *argv[])
   int size;
   octo_options options;
 
+  if (argc == 3 && strcmp(argv[1], "-a") == 0) {
+    return aot(argv[2]);
+  }
   if (argc != 4) {
     fprintf(stderr, "%d Usage: %s .../input.ch8 shiftQuirks loadStoreQuirks\n", argc, argv[0]);
+    fprintf(stderr, "       %s -a .../input.ch8|.ec8 > translation.c\n", argv[0]);
     return 1;
   }
 
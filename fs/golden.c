@@ -0,0 +1,423 @@
+/**
+ * Golden-frame test of the emulator core.
+ * Every ROM given runs headless with scripted input. At the checkpoint
+ * frames the display and the RAM are hashed and compared with the golden
+ * hashes in DIR/golden.txt. On a mismatch DIR/diff/NAME-FRAME.ppm shows
+ * the expected frame against the actual one: red only expected, green only
+ * actual, white both.
+ *
+ * The ROMs are shared out to one thread per core, a thread that runs out
+ * takes the last ROM of the busiest other thread.
+ *
+ * Input is read from DIR/NAME.keys if there is one, lines of
+ *   frame key frames
+ * pressing key (hex) at frame for frames. Otherwise each key is tapped in
+ * turn, one per second.
+ *
+ * Usage: golden [-u] [-j threads] DIR rom.ec8|rom.ch8...
+ * -u records the current hashes and frames as the golden ones.
+ *
+ * Built with SCREEN_PACKED (golden-packed) sprites are drawn by the
+ * firmware's packed display instead, on one thread as its planes are
+ * global, and px has to come out the same.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* the core's random numbers, made reproducible and per thread; the packed
+ * display's copy of the core calls them too */
+static __thread uint32_t seed;
+int
+golden_rand(void)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed & 0x7FFFFFFF;
+}
+#define rand golden_rand
+#include "../vendor/c-octo/src/octo_emulator.h"
+#undef rand
+#include "headless.h"
+
+#define NAME 64
+#define KEYS 256
+#define CHECKPOINTS 4
+
+static const int checkpoints[CHECKPOINTS] = { 30, 120, 600, 1800 };
+
+typedef struct {
+  int frame, key, frames;
+} press;
+
+typedef struct {
+  const char* path;
+  char name[NAME];
+  uint64_t px[CHECKPOINTS], ram[CHECKPOINTS];
+  int frames;                   /* checkpoints reached before a halt */
+  int failed;                   /* mismatching checkpoints, -1 if it couldn't run */
+  int known;                    /* has golden hashes */
+  uint64_t goldenPx[CHECKPOINTS], goldenRam[CHECKPOINTS];
+} job;
+
+typedef struct {
+  pthread_mutex_t lock;
+  int lo, hi;                   /* jobs not taken yet */
+} queue;
+
+static job* jobs;
+static queue* queues;
+static int threads;
+static int update;
+static const char* dir;
+
+static uint64_t
+hash(const uint8_t* data, size_t size)
+{
+  uint64_t h = 0xCBF29CE484222325ull;
+  size_t n;
+  for (n = 0; n < size; n++) {
+    h = (h ^ data[n]) * 0x100000001B3ull;
+  }
+  return h;
+}
+
+static int
+loadScript(const char* name, press* script)
+{
+  char path[NAME * 2];
+  FILE* f;
+  int n = 0;
+
+  snprintf(path, sizeof(path), "%s/%s.keys", dir, name);
+  f = fopen(path, "r");
+  if (f == NULL) {
+    /* each key for 6 frames every second */
+    for (n = 0; n < 16 * 4; n++) {
+      script[n].frame = 60 + n * 60;
+      script[n].key = n % 16;
+      script[n].frames = 6;
+    }
+    return n;
+  }
+  while (n < KEYS && fscanf(f, "%d %x %d", &script[n].frame, &script[n].key, &script[n].frames) == 3) {
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+/* the frame as PPM: planes 1 and 2 in grey levels, or the diff against expected */
+static void
+writeImage(const char* path, const uint8_t* px, const uint8_t* expected, int w, int h)
+{
+  FILE* f = fopen(path, "wb");
+  int n;
+  if (f == NULL) {
+    return;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", w, h);
+  for (n = 0; n < w * h; n++) {
+    uint8_t rgb[3];
+    if (expected) {
+      rgb[0] = expected[n] ? 255 : 0;
+      rgb[1] = px[n] ? 255 : 0;
+      rgb[2] = expected[n] && px[n] ? 255 : 0;
+    }
+    else {
+      rgb[0] = rgb[1] = rgb[2] = px[n] * 85;
+    }
+    fwrite(rgb, 1, 3, f);
+  }
+  fclose(f);
+}
+
+/* reads back a frame written by writeImage() */
+static int
+readImage(const char* path, uint8_t* px, int w, int h)
+{
+  FILE* f = fopen(path, "rb");
+  int fw, fh, max, n;
+  if (f == NULL) {
+    return 0;
+  }
+  if (fscanf(f, "P6 %d %d %d", &fw, &fh, &max) != 3 || fw != w || fh != h) {
+    fclose(f);
+    return 0;
+  }
+  fgetc(f);
+  for (n = 0; n < w * h; n++) {
+    uint8_t rgb[3];
+    if (fread(rgb, 1, 3, f) != 3) {
+      fclose(f);
+      return 0;
+    }
+    px[n] = rgb[0] / 85;
+  }
+  fclose(f);
+  return 1;
+}
+
+static void
+checkpoint(job* j, octo_emulator* emu, int c)
+{
+  int w = emu->hires ? 128 : 64, h = emu->hires ? 64 : 32;
+  char path[NAME * 3];
+
+  j->px[c] = hash(emu->px, w * h);
+  j->ram[c] = hash(emu->ram, sizeof(emu->ram));
+  j->frames = c + 1;
+
+  if (update) {
+    snprintf(path, sizeof(path), "%s/frames/%s-%d.ppm", dir, j->name, checkpoints[c]);
+    writeImage(path, emu->px, NULL, w, h);
+  }
+  else
+  if (c < j->known && (j->px[c] != j->goldenPx[c] || j->ram[c] != j->goldenRam[c])) {
+    uint8_t expected[128 * 64];
+    j->failed++;
+    snprintf(path, sizeof(path), "%s/frames/%s-%d.ppm", dir, j->name, checkpoints[c]);
+    int have = readImage(path, expected, w, h);
+    snprintf(path, sizeof(path), "%s/diff/%s-%d.ppm", dir, j->name, checkpoints[c]);
+    writeImage(path, emu->px, have ? expected : NULL, w, h);
+  }
+}
+
+static void
+run(job* j)
+{
+  static __thread octo_emulator emu;
+  static __thread press script[KEYS];
+  int frame, n, keys, c = 0;
+
+  if (!headless_load(j->path, &emu)) {
+    j->failed = -1;
+    return;
+  }
+  seed = 0x2545F491;
+  keys = loadScript(j->name, script);
+
+  for (frame = 1; c < CHECKPOINTS && !emu.halt; frame++) {
+    memset(emu.keys, 0, sizeof(emu.keys));
+    for (n = 0; n < keys; n++) {
+      if (frame >= script[n].frame && frame < script[n].frame + script[n].frames) {
+        emu.keys[script[n].key & 0xF] = 1;
+      }
+    }
+    headless_frame(&emu);
+
+    if (frame == checkpoints[c]) {
+      checkpoint(j, &emu, c++);
+    }
+  }
+}
+
+static int
+take(int self)
+{
+  int t, v, taken = -1, most = 0, victim = -1;
+
+  pthread_mutex_lock(&queues[self].lock);
+  if (queues[self].lo < queues[self].hi) {
+    taken = queues[self].lo++;
+  }
+  pthread_mutex_unlock(&queues[self].lock);
+  if (taken >= 0) {
+    return taken;
+  }
+
+  /* steal from the back of the longest queue */
+  for (t = 1; t < threads; t++) {
+    v = (self + t) % threads;
+    pthread_mutex_lock(&queues[v].lock);
+    if (queues[v].hi - queues[v].lo > most) {
+      most = queues[v].hi - queues[v].lo;
+      victim = v;
+    }
+    pthread_mutex_unlock(&queues[v].lock);
+  }
+  if (victim >= 0) {
+    pthread_mutex_lock(&queues[victim].lock);
+    if (queues[victim].lo < queues[victim].hi) {
+      taken = --queues[victim].hi;
+    }
+    pthread_mutex_unlock(&queues[victim].lock);
+  }
+  return taken;
+}
+
+static void*
+worker(void* arg)
+{
+  int self = (int)(intptr_t)arg;
+  int n;
+
+  /* another thread may have taken the last one in between, try until all are empty */
+  for (;;) {
+    n = take(self);
+    if (n < 0) {
+      int t, left = 0;
+      for (t = 0; t < threads; t++) {
+        pthread_mutex_lock(&queues[t].lock);
+        left += queues[t].hi - queues[t].lo;
+        pthread_mutex_unlock(&queues[t].lock);
+      }
+      if (!left) {
+        return NULL;
+      }
+      continue;
+    }
+    run(&jobs[n]);
+  }
+}
+
+static void
+loadGolden(int count)
+{
+  char path[NAME * 2], name[NAME];
+  int frame, n, c;
+  unsigned long long px, ram;
+  FILE* f;
+
+  snprintf(path, sizeof(path), "%s/golden.txt", dir);
+  f = fopen(path, "r");
+  if (f == NULL) {
+    return;
+  }
+  while (fscanf(f, "%63s %d %llx %llx", name, &frame, &px, &ram) == 4) {
+    for (n = 0; n < count; n++) {
+      if (strcmp(jobs[n].name, name) != 0) {
+        continue;
+      }
+      for (c = 0; c < CHECKPOINTS; c++) {
+        if (checkpoints[c] == frame) {
+          jobs[n].goldenPx[c] = px;
+          jobs[n].goldenRam[c] = ram;
+          jobs[n].known = c + 1 > jobs[n].known ? c + 1 : jobs[n].known;
+        }
+      }
+    }
+  }
+  fclose(f);
+}
+
+static int
+saveGolden(int count)
+{
+  char path[NAME * 2];
+  int n, c;
+  FILE* f;
+
+  snprintf(path, sizeof(path), "%s/golden.txt", dir);
+  f = fopen(path, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Error: Could not write file %s\n", path);
+    return 1;
+  }
+  for (n = 0; n < count; n++) {
+    for (c = 0; c < jobs[n].frames; c++) {
+      fprintf(f, "%s %d %016llx %016llx\n", jobs[n].name, checkpoints[c],
+        (unsigned long long)jobs[n].px[c], (unsigned long long)jobs[n].ram[c]);
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  pthread_t* ids;
+  char path[NAME * 2];
+  int opt, n, t, count, failed = 0, unknown = 0;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  while ((opt = getopt(argc, argv, "uj:")) != -1) {
+    if (opt == 'u') {
+      update = 1;
+    }
+    else
+    if (opt == 'j') {
+      threads = atoi(optarg);
+    }
+    else {
+      optind = argc;
+      break;
+    }
+  }
+  if (argc - optind < 2) {
+    fprintf(stderr, "Usage: %s [-u] [-j threads] dir rom.ec8|rom.ch8...\n", argv[0]);
+    return 1;
+  }
+  dir = argv[optind++];
+  count = argc - optind;
+  threads = threads < 1 ? 1 : threads > count ? count : threads;
+#ifdef SCREEN_PACKED
+  threads = 1;
+#endif
+
+  snprintf(path, sizeof(path), "%s/frames", dir);
+  mkdir(dir, 0755);
+  mkdir(path, 0755);
+  snprintf(path, sizeof(path), "%s/diff", dir);
+  mkdir(path, 0755);
+
+  jobs = calloc(count, sizeof(job));
+  for (n = 0; n < count; n++) {
+    const char* base = strrchr(argv[optind + n], '/');
+    char* dot;
+    jobs[n].path = argv[optind + n];
+    strncpy(jobs[n].name, base ? base + 1 : argv[optind + n], NAME - 1);
+    dot = strrchr(jobs[n].name, '.');
+    if (dot) {
+      *dot = '\0';
+    }
+  }
+  if (!update) {
+    loadGolden(count);
+  }
+
+  /* contiguous shares, stolen from the back */
+  queues = calloc(threads, sizeof(queue));
+  ids = calloc(threads, sizeof(pthread_t));
+  for (t = 0; t < threads; t++) {
+    pthread_mutex_init(&queues[t].lock, NULL);
+    queues[t].lo = count * t / threads;
+    queues[t].hi = count * (t + 1) / threads;
+  }
+  for (t = 0; t < threads; t++) {
+    pthread_create(&ids[t], NULL, worker, (void*)(intptr_t)t);
+  }
+  for (t = 0; t < threads; t++) {
+    pthread_join(ids[t], NULL);
+  }
+
+  if (update) {
+    printf("%d ROMs recorded\n", count);
+    return saveGolden(count);
+  }
+  for (n = 0; n < count; n++) {
+    if (jobs[n].failed < 0) {
+      printf("%s: can't run\n", jobs[n].name);
+      failed++;
+    }
+    else
+    if (!jobs[n].known) {
+      printf("%s: no golden hashes\n", jobs[n].name);
+      unknown++;
+    }
+    else
+    if (jobs[n].failed || jobs[n].frames != jobs[n].known) {
+      printf("%s: %d of %d checkpoints differ\n", jobs[n].name,
+        jobs[n].failed + abs(jobs[n].known - jobs[n].frames), jobs[n].known);
+      failed++;
+    }
+  }
+  printf("%d ROMs, %d failed, %d without golden hashes, %d threads\n", count, failed, unknown, threads);
+  return failed || unknown ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+/**
+ * The firmware's packed display for golden-packed, drawing with golden's
+ * random numbers like the core it's linked with.
+ */
+#include <stdlib.h>
+
+extern "C" int golden_rand(void);
+#define rand golden_rand
+#define SCREEN_PACKED
+#include "../src/screen.cpp"
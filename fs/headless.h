@@ -0,0 +1,95 @@
+/**
+ * Running ROMs headless in the tools the way the device does: a .ch8 gets
+ * its options from the ROM database (../src/romdb.cpp, linked in as
+ * romdb.o), a .ec8 carries them, and a frame is the one of emu_step().
+ * With SCREEN_PACKED sprites are drawn by ../src/screen.cpp (goldenscreen.o).
+ * Include it after octo_emulator.h.
+ */
+#ifndef _HEADLESS_H
+#define _HEADLESS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/romdb.h"
+#include "../src/screen.h"
+
+/* the ROM in path without the .ec8 header, to be freed; NULL if it can't be run */
+static uint8_t*
+headless_read(const char* path, octo_options* options, int* size)
+{
+  int raw = strlen(path) >= 4 && strcmp(path + strlen(path) - 4, ".ch8") == 0;
+  int head = raw ? 0 : sizeof(octo_options);
+  uint8_t* buffer;
+  FILE* f;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f) - head;
+  rewind(f);
+  if (*size <= 0) {
+    fclose(f);
+    return NULL;
+  }
+  buffer = malloc(*size + head);
+  if (fread(buffer, 1, *size + head, f) != (size_t)(*size + head)) {
+    fclose(f);
+    free(buffer);
+    return NULL;
+  }
+  fclose(f);
+
+  if (raw) {
+    romdb_options(buffer, *size, options);
+  }
+  else {
+    memcpy(options, buffer, sizeof(octo_options));
+    memmove(buffer, buffer + head, *size);
+  }
+  return buffer;
+}
+
+/* starts emu with the ROM in path, 0 if it can't be run */
+static int
+headless_load(const char* path, octo_emulator* emu)
+{
+  octo_options options;
+  uint8_t* rom;
+  int size;
+
+  rom = headless_read(path, &options, &size);
+  if (rom == NULL) {
+    return 0;
+  }
+  octo_emulator_init(emu, (char*)rom, size, &options, NULL);
+  screen_pack(emu);
+  free(rom);
+  return 1;
+}
+
+static void
+headless_timers(octo_emulator* emu)
+{
+  if (emu->dt > 0) emu->dt--;
+  if (emu->st > 0) emu->st--, emu->had_sound = 1;
+}
+
+/* the same frame as the device's emu_step() */
+static void
+headless_frame(octo_emulator* emu)
+{
+  int z;
+
+  for (z = 0; z < emu->options.tickrate && !emu->halt; z++) {
+    if (emu->options.q_vblank && (emu->ram[emu->pc & OCTO_RAM_MASK] & 0xF0) == 0xD0) {
+      z = emu->options.tickrate;
+    }
+    screen_instruction(emu);
+  }
+  headless_timers(emu);
+}
+
+#endif
@@ -0,0 +1,58 @@
+# Generate ../src/romdb_table.h, the options of known ROMs by content hash,
+# from chip8.txt: name,tickrate,background,fill1,fill2,blend,shiftQuirks,loadStoreQuirks
+import os
+
+OPTIONS_SIZE = 52   # sizeof(octo_options), in front of the ROM in .ec8 files
+
+def fnv1a(data):
+    h = 0x811C9DC5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+def rom(name):
+    ch8 = f"chip8Archive/roms/{name}.ch8"
+    if os.path.exists(ch8):
+        return open(ch8, 'rb').read()
+    ec8 = f"ec8/{name}.ec8"
+    if os.path.exists(ec8):
+        return open(ec8, 'rb').read()[OPTIONS_SIZE:]
+    return None
+
+# the CSS names used in chip8.txt
+NAMES = {
+    'black': '000000', 'white': 'ffffff', 'gray': '808080', 'lightgray': 'd3d3d3',
+    'red': 'ff0000', 'coral': 'ff7f50', 'hotpink': 'ff69b4', 'navy': '000080',
+    'lavender': 'e6e6fa', 'lightcyan': 'e0ffff', 'powderblue': 'b0e0e6',
+}
+
+def color(c):
+    c = NAMES.get(c.lower(), c.lstrip('#'))
+    if len(c) == 3:
+        c = ''.join(d * 2 for d in c)
+    return 0xFF000000 | int(c, 16)
+
+entries = {}
+for line in open('chip8.txt'):
+    f = line.strip().split(',')
+    if len(f) != 8:
+        continue
+    data = rom(f[0])
+    if data is None:
+        print(f"no ROM for {f[0]}")
+        continue
+    h = fnv1a(data)
+    if h in entries and entries[h][0] != f[0]:
+        print(f"{f[0]} has the same contents as {entries[h][0]}")
+    quirks = (1 if f[6] == '1' else 0) | (2 if f[7] == '1' else 0)
+    entries[h] = (f[0], len(data), int(f[1]), [color(c) for c in f[2:6]], quirks)
+
+with open('../src/romdb_table.h', 'w') as out:
+    out.write("// Generated by fs/romdb.py from fs/chip8.txt, don't edit\n")
+    out.write("static const romdb_entry romdb_table[] = {\n")
+    for h, (name, size, tickrate, colors, quirks) in sorted(entries.items()):
+        cols = ', '.join(f"0x{c:08X}" for c in colors)
+        out.write(f"  {{ 0x{h:08X}, {size}, {tickrate}, {{ {cols} }}, {quirks} }},   // {name}\n")
+    out.write("};\n")
+
+print(f"{len(entries)} ROMs")
@@ -0,0 +1,133 @@
+/**
+ * Make the thumbnail pack of the ROM browser.
+ * Each .ec8 (or .ch8, with its options from the ROM database) file is run
+ * headless for a few seconds, the frame with the most pixels set becomes
+ * its thumbnail: 64x32, 1 bit per pixel, hires frames reduced by ORing 2x2
+ * blocks.
+ *
+ * The pack (little endian) is a header followed by fixed-size records
+ * sorted by name, so it can be searched in place:
+ *   "ETHM", uint16 count, uint8 width, uint8 height
+ *   count x { char name[32] (without .ec8, NUL padded), uint8 bits[256] }
+ * Rows are 8 bytes, the leftmost pixel in the top bit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../vendor/c-octo/src/octo_emulator.h"
+#include "headless.h"
+
+#define FRAMES 300      /* 5 s at 60 Hz */
+#define W 64
+#define H 32
+#define NAME 32
+#define BYTES (W * H / 8)
+
+typedef struct {
+  char name[NAME];
+  unsigned char bits[BYTES];
+} thumb;
+
+static int
+compare(const void* a, const void* b)
+{
+  return strncmp(((const thumb*)a)->name, ((const thumb*)b)->name, NAME);
+}
+
+/* packs the current display, returns the number of pixels set */
+static int
+capture(octo_emulator* emu, unsigned char* bits)
+{
+  int x, y, set = 0;
+  int s = emu->hires ? 2 : 1, w = emu->hires ? 128 : 64;
+
+  memset(bits, 0, BYTES);
+  for (y = 0; y < H; y++) {
+    for (x = 0; x < W; x++) {
+      int on = emu->px[x * s + y * s * w];
+      if (s == 2) {
+        on |= emu->px[x * 2 + 1 + y * 2 * w] | emu->px[x * 2 + (y * 2 + 1) * w] |
+          emu->px[x * 2 + 1 + (y * 2 + 1) * w];
+      }
+      if (on) {
+        bits[y * W / 8 + x / 8] |= 0x80 >> (x & 7);
+        set++;
+      }
+    }
+  }
+  return set;
+}
+
+static int
+run(const char* filename, thumb* t)
+{
+  static octo_emulator emu;
+  unsigned char bits[BYTES];
+  const char* base;
+  char* dot;
+  int frame, set, best = -1;
+
+  if (!headless_load(filename, &emu)) {
+    fprintf(stderr, "Error: Could not run file %s\n", filename);
+    return 1;
+  }
+  for (frame = 0; frame < FRAMES && !emu.halt; frame++) {
+    headless_frame(&emu);
+    set = capture(&emu, bits);
+    if (set > best) {
+      best = set;
+      memcpy(t->bits, bits, BYTES);
+    }
+  }
+
+  base = strrchr(filename, '/');
+  base = base ? base + 1 : filename;
+  memset(t->name, 0, NAME);
+  strncpy(t->name, base, NAME - 1);
+  dot = strrchr(t->name, '.');
+  if (dot) {
+    memset(dot, 0, NAME - (dot - t->name));
+  }
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  FILE* f;
+  thumb* thumbs;
+  int n, count = 0;
+  unsigned char header[8] = { 'E', 'T', 'H', 'M', 0, 0, W, H };
+
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s thumbs.thm input.ec8|input.ch8...\n", argv[0]);
+    return 1;
+  }
+
+  thumbs = calloc(argc - 2, sizeof(thumb));
+  for (n = 2; n < argc; n++) {
+    if (strlen(argv[n]) < 4 || (strcmp(argv[n] + strlen(argv[n]) - 4, ".ec8") != 0 &&
+      strcmp(argv[n] + strlen(argv[n]) - 4, ".ch8") != 0)) {
+      continue;
+    }
+    if (run(argv[n], &thumbs[count]) == 0) {
+      count++;
+    }
+  }
+  qsort(thumbs, count, sizeof(thumb), compare);
+
+  f = fopen(argv[1], "wb");
+  if (f == NULL) {
+    fprintf(stderr, "Error: Could not write file %s\n", argv[1]);
+    return 1;
+  }
+  header[4] = count & 0xFF;
+  header[5] = count >> 8;
+  fwrite(header, 1, sizeof(header), f);
+  fwrite(thumbs, sizeof(thumb), count, f);
+  fclose(f);
+
+  printf("%d thumbnails\n", count);
+  free(thumbs);
+  return 0;
+}
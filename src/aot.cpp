@@ -0,0 +1,56 @@
+/**
+ * Ahead-of-time translated ROMs.
+ */
+#include "aot.h"
+
+#ifdef AOT_TABLE
+
+#ifndef TARGET_NATIVE
+# include <Arduino.h>
+#endif
+
+#include "latency.h"
+#include "romdb.h"
+#include "screen.h"
+
+#ifdef __has_include
+# if !__has_include("aot_table.h")
+#  error "AOT_TABLE needs src/aot_table.h, run make aot in fs"
+# endif
+#endif
+
+// a latency probe sees the key reads of both the interpreter and the
+// translated code
+static void instruction(octo_emulator* emu) {
+  if (latency_reading()) {
+    latency_instruction(emu, micros());
+  }
+  screen_instruction(emu);
+}
+
+static void keyRead(int key) {
+  if (latency_reading()) {
+    latency_key(key, micros());
+  }
+}
+
+#define AOT_INSTRUCTION instruction
+#define AOT_KEY_READ(emu, key) keyRead(key)
+#include "aot_runtime.h"
+
+static bool active;
+
+bool aot_attach(const uint8_t* rom, int size) {
+  active = aot_use(romdb_hash(rom, size), rom, size);
+  return active;
+}
+
+bool aot_active(void) {
+  return active;
+}
+
+void aot_run(octo_emulator* emu, int cycles) {
+  aot_step(emu, cycles);
+}
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Ahead-of-time translated ROMs, built with AOT_TABLE.
+ *
+ * fs/aot.py has ch8toec8 -a translate the code of the fast ROMs of
+ * fs/chip8.txt to C and keeps those fs/aotbench measures faster than the
+ * interpreter, in aot_table.h keyed by a hash of the ROM (generated, not
+ * checked in). A loaded ROM found there runs its frames through the
+ * translation; what isn't translated, and code the program rewrote, goes
+ * to the interpreter.
+ */
+#ifndef _AOT_H
+#define _AOT_H
+
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#ifdef AOT_TABLE
+
+// Picks the translation of rom, false if there is none. rom has to stay
+// as loaded while it's used.
+bool aot_attach(const uint8_t* rom, int size);
+
+bool aot_active(void);
+
+// Runs up to cycles instructions, like the interpreter loop of emu_step()
+void aot_run(octo_emulator* emu, int cycles);
+
+#else
+
+static inline bool aot_attach(const uint8_t* rom, int size) {
+  return false;
+}
+
+static inline bool aot_active(void) {
+  return false;
+}
+
+static inline void aot_run(octo_emulator* emu, int cycles) {
+}
+
+#endif
+
+#endif
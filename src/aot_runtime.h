@@ -0,0 +1,140 @@
+/**
+ * Running ahead-of-time translated ROMs, shared by the firmware (aot.cpp)
+ * and fs/aotbench.c. Each includes it once; AOT_INSTRUCTION names the
+ * interpreter used for what isn't translated, AOT_KEY_READ(emu, key) is
+ * told of the key tests of translated code.
+ *
+ * A translation is only used for the ROM it was made from, and a run of
+ * its code only while RAM still holds the ROM's bytes there: writes by
+ * the program are checked as they happen, anything else (the monitor,
+ * snapshots, rewind) at the start of each frame.
+ */
+#ifndef _AOT_RUNTIME_H
+#define _AOT_RUNTIME_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef AOT_INSTRUCTION
+# define AOT_INSTRUCTION octo_emulator_instruction
+#endif
+#ifndef AOT_KEY_READ
+# define AOT_KEY_READ(emu, key)
+#endif
+
+typedef struct {
+  uint32_t hash;          // FNV-1a of the ROM
+  uint16_t size;
+  uint16_t runCount;
+  const uint16_t* runs;   // from, to of the translated bytes
+  int (*step)(octo_emulator* emu, int cycles, const uint8_t* stale);
+} aot_entry;
+
+static const aot_entry* aot_current;
+static const uint8_t* aot_rom;    // loaded at 0x200
+static uint8_t* aot_stale;        // per run, rewritten by the program
+
+// Marks the runs overlapping from..to whose bytes changed
+static void aot_verify(const octo_emulator* emu, int from, int to) {
+  const uint16_t* runs = aot_current->runs;
+  // the first run ending past from
+  int r = 0, n = aot_current->runCount;
+  while (n > 0) {
+    int half = n / 2;
+    if (runs[(r + half)*2 + 1] <= from) {
+      r += half + 1;
+      n -= half + 1;
+    }
+    else {
+      n = half;
+    }
+  }
+  for (; r < aot_current->runCount && runs[r*2] <= to; r++) {
+    int lo = runs[r*2], hi = runs[r*2 + 1];
+    if (!aot_stale[r] && memcmp(emu->ram + lo, aot_rom + lo - 0x200, hi - lo) != 0) {
+      aot_stale[r] = 1;
+    }
+  }
+}
+
+// Whether key is down, for a translated EX9E or EXA1
+static inline int aot_key(octo_emulator* emu, int key) {
+  AOT_KEY_READ(emu, key & 0xF);
+  return emu->keys[key & 0xF];
+}
+
+// Interprets one instruction, true if it ends the frame
+static int aot_one(octo_emulator* emu) {
+  const uint8_t op = emu->ram[emu->pc & OCTO_RAM_MASK];
+  const uint8_t arg = emu->ram[(emu->pc + 1) & OCTO_RAM_MASK];
+  const int x = op & 0xF, y = arg >> 4;
+  const int i = emu->i;
+  int written = -1;       // bytes stored from i on
+  if ((op & 0xF0) == 0xF0 && arg == 0x33) {
+    written = 3;
+  }
+  else
+  if ((op & 0xF0) == 0xF0 && arg == 0x55) {
+    written = x + 1;
+  }
+  else
+  if ((op & 0xF0) == 0x50 && (arg & 0xF) == 2) {
+    written = (x < y ? y - x : x - y) + 1;
+  }
+  int frame = emu->options.q_vblank && (op & 0xF0) == 0xD0;
+
+  AOT_INSTRUCTION(emu);
+  if (written > 0) {
+    if (((i + written - 1) & OCTO_RAM_MASK) < (i & OCTO_RAM_MASK)) {
+      aot_verify(emu, 0, OCTO_RAM_MASK);    // wrapped around
+    }
+    else {
+      aot_verify(emu, i & OCTO_RAM_MASK, (i + written - 1) & OCTO_RAM_MASK);
+    }
+  }
+  return frame;
+}
+
+#include "aot_table.h"
+
+static const int AOT_COUNT = sizeof(aot_table) / sizeof(aot_table[0]);
+
+// Uses the translation of rom if there is one, returns false otherwise
+static int aot_use(uint32_t hash, const uint8_t* rom, int size) {
+  free(aot_stale);
+  aot_stale = NULL;
+  aot_current = NULL;
+  int lo = 0, hi = AOT_COUNT - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (aot_table[mid].hash < hash) {
+      lo = mid + 1;
+    }
+    else
+    if (aot_table[mid].hash > hash) {
+      hi = mid - 1;
+    }
+    else {
+      if (aot_table[mid].size != size) {
+        return 0;
+      }
+      aot_stale = (uint8_t*)calloc(aot_table[mid].runCount + 1, 1);
+      if (!aot_stale) {
+        return 0;
+      }
+      aot_current = &aot_table[mid];
+      aot_rom = rom;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Runs up to cycles instructions like the interpreter loop, returns how many
+static int aot_step(octo_emulator* emu, int cycles) {
+  aot_verify(emu, 0, OCTO_RAM_MASK);
+  return aot_current->step(emu, cycles, aot_stale);
+}
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * XO-CHIP sound.
+ *
+ * The phase is a 32-bit fraction of the pattern, its top 7 bits select the
+ * bit played. The pattern is expanded into a table of samples and the
+ * phase increment is computed only when they change. A new table is
+ * written to the spare buffer and picked up by the feeder's next block.
+ */
+#include <math.h>
+#include <string.h>
+
+#ifdef TARGET_NATIVE
+# include <lgfx/v1/platforms/sdl/Panel_sdl.hpp>
+#else
+# include <Arduino.h>
+# include <driver/i2s.h>
+#endif
+
+#include "audio.h"
+
+#define AUDIO_FRAG_SIZE 256       // samples per write, 8 ms
+#define AUDIO_VOLUME (INT16_MAX / 4)
+
+// the built-in DAC only runs on I2S 0; its left channel is DAC2 on GPIO26,
+// the board's speaker
+#define I2S_NUM 0
+
+#if defined(SPEAK) && SPEAK != 26
+# error "The speaker has to be on GPIO26, the built-in DAC's left channel"
+#endif
+
+static int16_t table[2][128];
+static volatile int current;        // table being played
+static volatile uint32_t increment; // phase per sample
+static volatile bool active;        // the sound timer ran last tick
+static uint32_t phase;
+
+// what the tables and increment were made from
+static uint8_t pattern[16];
+static int pitch = -1;
+
+static void fill(int16_t* stream, int len) {
+  const int16_t* t = table[current];
+  uint32_t inc = increment;
+
+  if (!active) {
+    memset(stream, 0, len * sizeof(int16_t));
+    return;
+  }
+  for (int z = 0; z < len; z++) {
+    stream[z] = t[phase >> 25];
+    phase += inc;
+  }
+}
+
+void audio_update(octo_emulator* emu) {
+  if (emu->pitch != pitch) {
+    pitch = emu->pitch;
+    double freq = 4000 * pow(2, (pitch - 64) / 48.0);
+    increment = (uint32_t)(freq * (1 << 25) / AUDIO_SAMPLE_RATE);
+  }
+  if (memcmp(pattern, emu->pattern, sizeof(pattern)) != 0) {
+    memcpy(pattern, emu->pattern, sizeof(pattern));
+
+    // programs that never set a pattern get a square wave
+    bool none = true;
+    for (int n = 0; n < 16; n++) {
+      none = none && !pattern[n];
+    }
+    int16_t* t = table[current ^ 1];
+    for (int n = 0; n < 128; n++) {
+      bool bit = none ? (n >> 3) & 1 : (pattern[n >> 3] >> ((n & 7) ^ 7)) & 1;
+      t[n] = bit ? AUDIO_VOLUME : 0;
+    }
+    current ^= 1;
+  }
+  active = emu->had_sound;
+  emu->had_sound = 0;
+}
+
+#ifdef TARGET_NATIVE
+static void pump(void* user, Uint8* stream, int len) {
+  fill((int16_t*)stream, len / sizeof(int16_t));
+}
+
+bool audio_init(void) {
+  SDL_AudioSpec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.freq = AUDIO_SAMPLE_RATE;
+  spec.format = AUDIO_S16SYS;
+  spec.channels = 1;
+  spec.samples = AUDIO_FRAG_SIZE;
+  spec.callback = pump;
+
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+    return false;
+  }
+  SDL_AudioDeviceID dev = SDL_OpenAudioDevice(NULL, 0, &spec, NULL, 0);
+  if (!dev) {
+    return false;
+  }
+  SDL_PauseAudioDevice(dev, 0);
+  return true;
+}
+#else
+// Blocks in i2s_write() until a DMA buffer is free
+static void feed(void* param) {
+  static int16_t stream[AUDIO_FRAG_SIZE];
+  size_t written;
+
+  for (;;) {
+    fill(stream, AUDIO_FRAG_SIZE);
+    i2s_write(I2S_NUM, stream, sizeof(stream), &written, portMAX_DELAY);
+  }
+}
+
+// The DAC plays the top byte of each sample unsigned, silence is 0
+bool audio_init(void) {
+  const i2s_config_t i2s_config = {
+    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN),
+    .sample_rate = AUDIO_SAMPLE_RATE,
+    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+    .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+    .intr_alloc_flags = 0,
+    .dma_buf_count = 4,
+    .dma_buf_len = AUDIO_FRAG_SIZE,
+    .use_apll = false,
+    .tx_desc_auto_clear = true, // silence on underflow
+    .fixed_mclk = 0
+  };
+
+  if (i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL) != ESP_OK ||
+    i2s_set_pin(I2S_NUM, NULL) != ESP_OK ||
+    i2s_set_dac_mode(I2S_DAC_CHANNEL_LEFT_EN) != ESP_OK) {
+    return false;
+  }
+  // the loop runs on core 1, WiFi and the feeder share core 0
+  return xTaskCreatePinnedToCore(feed, "audio", 2048, NULL, 5, NULL, 0) == pdPASS;
+}
+#endif
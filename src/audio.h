@@ -0,0 +1,23 @@
+/**
+ * XO-CHIP sound: the 128-bit pattern played at the pitch register's rate
+ * while the sound timer runs.
+ *
+ * A feeder task (an SDL audio callback on native) fills the DMA buffers
+ * from a phase accumulator, the emulator only hands over changes.
+ */
+#ifndef _AUDIO_H
+#define _AUDIO_H
+
+#include <octo_emulator.h>
+
+#define AUDIO_SAMPLE_RATE (4096*8)
+
+// Starts the output, false if the driver couldn't be set up
+bool audio_init(void);
+
+// Call every tick, emulated or not: takes over pitch and pattern if they
+// changed and whether the sound timer ran (clears emu->had_sound); the
+// sound stops in a tick it didn't
+void audio_update(octo_emulator* emu);
+
+#endif
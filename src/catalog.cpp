@@ -0,0 +1,336 @@
+/**
+ * Program catalog.
+ *
+ * Index file format (little endian): "ECAT", uint32 count, then count
+ * NUL padded names of CATALOG_NAME bytes, sorted.
+ *
+ * Building it sorts runs of RUN_NAMES names in memory into a temporary
+ * file and merges them in one pass, remembering only the head of each
+ * run. Adding or removing a name copies the index with the change.
+ *
+ * The web server changes the catalog while the loop reads it, every
+ * entry point holds the lock.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <mutex>
+#include <SPIFFS.h>
+
+#include "catalog.h"
+#include "console.h"
+
+#define RUN_NAMES 512         // sorted in memory while building, 16K
+#define RUNS_MAX 64           // so up to 32768 programs
+
+static const char* INDEX_PATH = "/catalog.idx";
+static const char* TEMP_PATH = "/catalog.tmp";
+static const uint32_t MAGIC = 0x54414345;  // "ECAT"
+static const size_t HEADER = 8;
+
+typedef char Name[CATALOG_NAME];
+
+struct Page {
+  int first;                  // index of names[0], -1 if unused
+  uint32_t used;              // when last read, for replacing
+  Name names[CATALOG_PAGE];
+};
+
+static Page pages[CATALOG_PAGES];
+static uint32_t useClock;
+static File indexFile;
+static bool opened;
+static int count;
+static std::recursive_mutex lock;
+
+// Case-insensitive, with ties broken so the order is total
+static int compare(const char* a, const char* b) {
+  int c = strcasecmp(a, b);
+  return c ? c : strcmp(a, b);
+}
+
+static int compareNames(const void* a, const void* b) {
+  return compare((const char*)a, (const char*)b);
+}
+
+// Older cores return the path, newer ones the name
+static const char* baseName(const char* path) {
+  const char* p = strrchr(path, '/');
+  return p ? p + 1 : path;
+}
+
+static bool isProgram(const char* name) {
+  size_t len = strlen(name);
+  return len > 4 && len < CATALOG_NAME &&
+    (strcmp(name + len - 4, ".ec8") == 0 || strcmp(name + len - 4, ".ch8") == 0);
+}
+
+static void forget(void) {
+  for (int n = 0; n < CATALOG_PAGES; n++) {
+    pages[n].first = -1;
+  }
+}
+
+static void closeIndex(void) {
+  if (opened) {
+    indexFile.close();
+    opened = false;
+  }
+  forget();
+}
+
+static bool writeHeader(File& f, int n) {
+  uint8_t h[HEADER];
+  memcpy(h, &MAGIC, 4);
+  h[4] = n;
+  h[5] = n >> 8;
+  h[6] = n >> 16;
+  h[7] = n >> 24;
+  return f.write(h, sizeof(h)) == sizeof(h);
+}
+
+static bool readName(File& f, int i, char* name) {
+  return f.seek(HEADER + (size_t)i * CATALOG_NAME) &&
+    f.read((uint8_t*)name, CATALOG_NAME) == CATALOG_NAME;
+}
+
+// Replaces the index with the one written to TEMP_PATH
+static bool commit(void) {
+  closeIndex();
+  SPIFFS.remove(INDEX_PATH);
+  return SPIFFS.rename(TEMP_PATH, INDEX_PATH) && catalog_open();
+}
+
+bool catalog_open(void) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (opened) {
+    return true;
+  }
+  indexFile = SPIFFS.open(INDEX_PATH, FILE_READ);
+  uint8_t h[HEADER];
+  uint32_t magic = 0;
+  if (indexFile && indexFile.read(h, sizeof(h)) == sizeof(h)) {
+    memcpy(&magic, h, 4);
+  }
+  if (magic != MAGIC) {
+    if (indexFile) {
+      indexFile.close();
+    }
+    return catalog_rebuild();
+  }
+  count = h[4] | h[5] << 8 | h[6] << 16 | (uint32_t)h[7] << 24;
+  opened = true;
+  forget();
+  return true;
+}
+
+// Merges the sorted runs of temp into a new index
+static bool merge(File& temp, int total) {
+  int runs = (total + RUN_NAMES - 1) / RUN_NAMES;
+  Name* heads = (Name*)malloc(runs * sizeof(Name));
+  int* next = (int*)malloc(runs * sizeof(int));
+  File out = SPIFFS.open(INDEX_PATH, FILE_WRITE);
+  bool ok = (!runs || (heads && next)) && out && writeHeader(out, total);
+
+  for (int r = 0; ok && r < runs; r++) {
+    next[r] = r * RUN_NAMES;
+    ok = readName(temp, next[r]++, heads[r]);
+  }
+  for (int n = 0; ok && n < total; n++) {
+    int min = -1;
+    for (int r = 0; r < runs; r++) {
+      if (heads[r][0] && (min < 0 || compare(heads[r], heads[min]) < 0)) {
+        min = r;
+      }
+    }
+    ok = out.write((const uint8_t*)heads[min], CATALOG_NAME) == CATALOG_NAME;
+    // an empty head marks the end of a run
+    int end = (min + 1) * RUN_NAMES < total ? (min + 1) * RUN_NAMES : total;
+    if (next[min] < end) {
+      ok = ok && readName(temp, next[min]++, heads[min]);
+    }
+    else {
+      heads[min][0] = '\0';
+    }
+  }
+
+  if (out) {
+    out.close();
+  }
+  free(heads);
+  free(next);
+  return ok;
+}
+
+bool catalog_rebuild(void) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  closeIndex();
+  unsigned long start = millis();
+  Name* run = (Name*)malloc(RUN_NAMES * sizeof(Name));
+  // created before the scan, so the scan doesn't come across it
+  File temp = SPIFFS.open(TEMP_PATH, FILE_WRITE);
+  File dir = SPIFFS.open("/");
+  if (!run || !temp || !dir) {
+    console_printf("Catalog: can't build the index\r\n");
+    free(run);
+    return false;
+  }
+
+  // the runs are read back like an index
+  int total = 0, n = 0;
+  bool ok = writeHeader(temp, 0);
+  for (File f = dir.openNextFile(); f && ok; f = dir.openNextFile()) {
+    const char* name = baseName(f.name());
+    if (!isProgram(name)) {
+      continue;
+    }
+    if (total + n == RUN_NAMES * RUNS_MAX) {
+      console_printf("Catalog: more than %d programs\r\n", RUN_NAMES * RUNS_MAX);
+      break;
+    }
+    memset(run[n], 0, CATALOG_NAME);
+    strcpy(run[n++], name);
+    if (n == RUN_NAMES) {
+      qsort(run, n, sizeof(Name), compareNames);
+      ok = temp.write((const uint8_t*)run, sizeof(Name) * n) == sizeof(Name) * n;
+      total += n;
+      n = 0;
+    }
+  }
+  qsort(run, n, sizeof(Name), compareNames);
+  ok = ok && temp.write((const uint8_t*)run, sizeof(Name) * n) == sizeof(Name) * n;
+  total += n;
+  free(run);
+  temp.close();
+
+  File runs = SPIFFS.open(TEMP_PATH, FILE_READ);
+  ok = ok && runs && merge(runs, total);
+  if (runs) {
+    runs.close();
+  }
+  SPIFFS.remove(TEMP_PATH);
+  console_printf("Catalog: %d programs indexed in %lu ms\r\n", total, millis() - start);
+  return ok && catalog_open();
+}
+
+int catalog_count(void) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  return opened ? count : 0;
+}
+
+bool catalog_name(int i, char* name) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (!opened || i < 0 || i >= count) {
+    return false;
+  }
+  int first = i - i % CATALOG_PAGE;
+  Page* page = &pages[0];
+  for (int n = 0; n < CATALOG_PAGES; n++) {
+    if (pages[n].first == first) {
+      page = &pages[n];
+      break;
+    }
+    if (pages[n].used < page->used) {
+      page = &pages[n];
+    }
+  }
+  if (page->first != first) {
+    int names = count - first < CATALOG_PAGE ? count - first : CATALOG_PAGE;
+    size_t size = names * sizeof(Name);
+    if (!indexFile.seek(HEADER + (size_t)first * CATALOG_NAME) ||
+      indexFile.read((uint8_t*)page->names, size) != size) {
+      page->first = -1;
+      return false;
+    }
+    page->first = first;
+  }
+  page->used = ++useClock;
+  memcpy(name, page->names[i - first], CATALOG_NAME);
+  name[CATALOG_NAME - 1] = '\0';
+  return true;
+}
+
+int catalog_find(const char* prefix) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  int lo = 0, hi = catalog_count();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    Name name;
+    if (!catalog_name(mid, name)) {
+      return catalog_count();
+    }
+    if (strcasecmp(name, prefix) < 0) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+int catalog_index(const char* name) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  Name found;
+  for (int i = catalog_find(name); catalog_name(i, found) && strcasecmp(found, name) == 0; i++) {
+    if (strcmp(found, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Copies the index to TEMP_PATH, with name inserted or left out
+static bool rewrite(const char* name, bool add) {
+  if (!catalog_open()) {
+    return false;
+  }
+  File out = SPIFFS.open(TEMP_PATH, FILE_WRITE);
+  if (!out) {
+    return false;
+  }
+  Name entry;
+  memset(entry, 0, sizeof(entry));
+  strcpy(entry, name);
+  bool ok = writeHeader(out, count + (add ? 1 : -1));
+  bool done = false;
+  for (int i = 0; ok && i < count; i++) {
+    Name n;
+    ok = catalog_name(i, n);
+    int c = compare(entry, n);
+    if (add && !done && c < 0) {
+      ok = ok && out.write((const uint8_t*)entry, CATALOG_NAME) == CATALOG_NAME;
+      done = true;
+    }
+    if (add || c != 0) {
+      ok = ok && out.write((const uint8_t*)n, CATALOG_NAME) == CATALOG_NAME;
+    }
+  }
+  if (add && !done) {
+    ok = ok && out.write((const uint8_t*)entry, CATALOG_NAME) == CATALOG_NAME;
+  }
+  out.close();
+  if (!ok) {
+    SPIFFS.remove(TEMP_PATH);
+    return false;
+  }
+  return commit();
+}
+
+bool catalog_add(const char* name) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  name = baseName(name);
+  if (!isProgram(name) || !catalog_open()) {
+    return false;
+  }
+  return catalog_index(name) >= 0 || rewrite(name, true);
+}
+
+bool catalog_remove(const char* name) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  name = baseName(name);
+  if (!catalog_open()) {
+    return false;
+  }
+  return catalog_index(name) < 0 || rewrite(name, false);
+}
@@ -0,0 +1,38 @@
+/**
+ * The program catalog: the .ec8 and .ch8 files of the root directory as a
+ * sorted index on storage, read through a small cache of pages.
+ *
+ * The index is built once and kept up to date by catalog_add() and
+ * catalog_remove(), so neither the memory used nor opening the catalog
+ * grows with the number of programs. Names sort ignoring case.
+ */
+#ifndef _CATALOG_H
+#define _CATALOG_H
+
+#define CATALOG_NAME 32       // bytes per name with the terminating NUL
+#define CATALOG_PAGE 16       // names per cached page
+#define CATALOG_PAGES 4       // cached pages
+
+// Opens the index, building it if there is none. False if that failed.
+bool catalog_open(void);
+
+// Scans the directory into a new index
+bool catalog_rebuild(void);
+
+int catalog_count(void);
+
+// Copies the i-th file name (without '/') to name, false if out of range
+bool catalog_name(int i, char* name);
+
+// Index of the first name not sorting before prefix, catalog_count() if
+// there is none
+int catalog_find(const char* prefix);
+
+// Index of name, -1 if it isn't in the catalog
+int catalog_index(const char* name);
+
+// Keep the index in step with files written or removed
+bool catalog_add(const char* name);
+bool catalog_remove(const char* name);
+
+#endif
@@ -1,27 +1,349 @@
-#include "console.h"
+#include <atomic>
+#include <string.h>
 
 #ifdef TARGET_NATIVE
+# include <stdlib.h>
+# include <chrono>
+# include <thread>
+#endif
+
+#include "console.h"
+
+/**
+ * The queue is a bounded multi-producer queue of slots with sequence
+ * numbers: a slot is free for message pos when its sequence is pos, and
+ * holds it when it's pos + 1. Writers claim pos by advancing head.
+ * A slot keeps its sequence less its index, so the zeroed slots are free
+ * for the first lap without a constructor, whatever logs first.
+ */
+
+enum Tag : uint8_t {
+  T_INT,      // any integer conversion, formatted with ll
+  T_DOUBLE,
+  T_PTR,
+  T_STR       // offset into text
+};
+
+struct Slot {
+  std::atomic<uint32_t> seq;
+  const char* fmt;
+  uint8_t count;
+  Tag tags[CONSOLE_ARGS];
+  union {
+    long long i;
+    double d;
+    const void* p;
+    uint16_t s;
+  } args[CONSOLE_ARGS];
+  char text[CONSOLE_TEXT];
+};
+
+static Slot slots[CONSOLE_SLOTS];
+static std::atomic<uint32_t> head;
+static std::atomic<uint32_t> tail;
+static std::atomic<uint32_t> dropped;
+static std::atomic<bool> writing;
+
+static uint32_t loadSeq(const Slot* slot) {
+  return slot->seq.load(std::memory_order_acquire) + (uint32_t)(slot - slots);
+}
+
+static void storeSeq(Slot* slot, uint32_t seq) {
+  slot->seq.store(seq - (uint32_t)(slot - slots), std::memory_order_release);
+}
+
+// A conversion of the format: where it starts and ends, its type
+struct Spec {
+  const char* start;
+  const char* end;
+  char conv;
+  bool isLong;        // l, L or wider
+  bool isLongLong;
+  int stars;          // * for width or precision
+};
+
+static const char* nextSpec(const char* p, Spec* spec) {
+  for (; *p; p++) {
+    if (*p != '%') {
+      continue;
+    }
+    spec->start = p++;
+    spec->stars = 0;
+    spec->isLong = spec->isLongLong = false;
+    while (*p && strchr("-+ #0", *p)) {
+      p++;
+    }
+    for (; *p && (strchr("0123456789.", *p) || *p == '*'); p++) {
+      spec->stars += *p == '*';
+    }
+    for (; *p && strchr("hlLzjt", *p); p++) {
+      spec->isLongLong = spec->isLongLong || (*p == 'l' && spec->isLong) || *p == 'j';
+      spec->isLong = spec->isLong || strchr("lLzt", *p);
+    }
+    spec->conv = *p;
+    spec->end = *p ? p + 1 : p;
+    return spec->end;
+  }
+  return NULL;
+}
+
+void console_printf(const char* fmt, ...) {
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots[pos % CONSOLE_SLOTS];
+    int32_t diff = (int32_t)(loadSeq(slot) - pos);
+    if (diff == 0) {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else
+    if (diff < 0) {
+      dropped++;
+      return;
+    }
+    else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
 
-void
-console_printf(const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  vprintf(fmt, args);
+  slot->fmt = fmt;
+  slot->count = 0;
+  size_t text = 0;
+  Spec spec;
+  for (const char* p = fmt; (p = nextSpec(p, &spec)) && slot->count < CONSOLE_ARGS; ) {
+    for (int n = 0; n < spec.stars && slot->count < CONSOLE_ARGS; n++) {
+      slot->tags[slot->count] = T_INT;
+      slot->args[slot->count++].i = va_arg(args, int);
+    }
+    if (slot->count == CONSOLE_ARGS) {
+      break;
+    }
+    Tag* tag = &slot->tags[slot->count];
+    switch (spec.conv) {
+      case 'd':
+      case 'i':
+        *tag = T_INT;
+        slot->args[slot->count++].i = spec.isLongLong ? va_arg(args, long long) :
+          spec.isLong ? va_arg(args, long) : va_arg(args, int);
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+      case 'c':
+        *tag = T_INT;
+        slot->args[slot->count++].i = spec.isLongLong ? va_arg(args, unsigned long long) :
+          spec.isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        *tag = T_DOUBLE;
+        slot->args[slot->count++].d = spec.isLong ? va_arg(args, long double) : va_arg(args, double);
+        break;
+      case 'p':
+        *tag = T_PTR;
+        slot->args[slot->count++].p = va_arg(args, void*);
+        break;
+      case 's': {
+        const char* s = va_arg(args, const char*);
+        if (!s) {
+          s = "(null)";
+        }
+        // strings share text, the last byte stays '\0'
+        size_t room = text < CONSOLE_TEXT - 1 ? CONSOLE_TEXT - 1 - text : 0;
+        size_t len = strnlen(s, room);
+        memcpy(slot->text + text, s, len);
+        slot->text[text + len] = '\0';
+        *tag = T_STR;
+        slot->args[slot->count++].s = text;
+        text = text + len + 1 < CONSOLE_TEXT - 1 ? text + len + 1 : CONSOLE_TEXT - 1;
+        break;
+      }
+    }
+  }
   va_end(args);
-  fflush(stdout);
+  storeSeq(slot, pos + 1);
 }
 
+static void write(const char* s, size_t len) {
+#ifdef TARGET_NATIVE
+  fwrite(s, 1, len, stdout);
 #else
+  Serial.write((const uint8_t*)s, len);
+#endif
+}
 
-void
-console_printf(const char* fmt, ...) {
-  va_list args;
-  va_start(args, fmt);
-  char buf[256];
-  vsnprintf(buf, sizeof(buf), fmt, args);
-  Serial.print(buf);
-  va_end(args);
+// Formats one conversion with its arguments
+static void format(char* out, size_t size, const Spec* spec, const Slot* slot, int arg) {
+  char f[24];
+  size_t n = 0;
+  for (const char* p = spec->start; p < spec->end - 1 && n < sizeof(f) - 4; p++) {
+    // integers go as long long
+    if (!strchr("hlLzjt", *p)) {
+      f[n++] = *p;
+    }
+  }
+  if (slot->tags[arg + spec->stars] == T_INT && spec->conv != 'c') {
+    f[n++] = 'l';
+    f[n++] = 'l';
+  }
+  f[n++] = spec->conv;
+  f[n] = '\0';
+
+  int w = spec->stars > 0 ? (int)slot->args[arg].i : 0;
+  int pr = spec->stars > 1 ? (int)slot->args[arg + 1].i : 0;
+  arg += spec->stars;
+
+  const Tag tag = slot->tags[arg];
+#define CONSOLE_FORMAT(value) \
+  (spec->stars == 2 ? snprintf(out, size, f, w, pr, value) : \
+   spec->stars == 1 ? snprintf(out, size, f, w, value) : snprintf(out, size, f, value))
+  if (tag == T_INT) {
+    if (spec->conv == 'c') {
+      CONSOLE_FORMAT((int)slot->args[arg].i);
+    }
+    else {
+      CONSOLE_FORMAT(slot->args[arg].i);
+    }
+  }
+  else
+  if (tag == T_DOUBLE) {
+    CONSOLE_FORMAT(slot->args[arg].d);
+  }
+  else
+  if (tag == T_PTR) {
+    CONSOLE_FORMAT(slot->args[arg].p);
+  }
+  else {
+    CONSOLE_FORMAT(slot->text + slot->args[arg].s);
+  }
+#undef CONSOLE_FORMAT
+}
+
+static void print(const Slot* slot) {
+  char buf[CONSOLE_TEXT];
+  const char* p = slot->fmt;
+  int arg = 0;
+  Spec spec;
+
+  for (const char* next; (next = nextSpec(p, &spec)); p = next) {
+    write(p, spec.start - p);
+    if (spec.conv == '%') {
+      write("%", 1);
+    }
+    else
+    if (arg + spec.stars < slot->count) {
+      format(buf, sizeof(buf), &spec, slot, arg);
+      write(buf, strnlen(buf, sizeof(buf)));
+      arg += spec.stars + 1;
+    }
+    else {
+      // past CONSOLE_ARGS
+      arg = slot->count;
+    }
+  }
+  write(p, strlen(p));
+}
+
+// Writes what's queued, false if there was nothing
+static bool drain(void) {
+  bool any = false;
+  bool idle = false;
+  if (!writing.compare_exchange_strong(idle, true)) {
+    return false;
+  }
+  for (;;) {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    Slot* slot = &slots[pos % CONSOLE_SLOTS];
+    if (loadSeq(slot) != pos + 1) {
+      break;
+    }
+    print(slot);
+    storeSeq(slot, pos + CONSOLE_SLOTS);
+    tail.store(pos + 1, std::memory_order_relaxed);
+    any = true;
+  }
+  uint32_t lost = dropped.exchange(0);
+  if (lost) {
+    char buf[32];
+    write(buf, snprintf(buf, sizeof(buf), "(%u dropped)\r\n", (unsigned)lost));
+  }
+#ifdef TARGET_NATIVE
+  if (any) {
+    fflush(stdout);
+  }
+#endif
+  writing = false;
+  return any;
+}
+
+static const int FLUSH_MS = 500;    // a full queue takes ~250 ms at 115200 baud
+
+static void nap(void) {
+#ifdef TARGET_NATIVE
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#else
+  vTaskDelay(1);
+#endif
+}
+
+void console_flush(void) {
+  // the writer may be busy with it, then it's waited for
+  for (int n = 0; n < FLUSH_MS; n++) {
+    drain();
+    if (!writing && tail.load() == head.load()) {
+      break;
+    }
+    nap();
+  }
+#ifndef TARGET_NATIVE
   Serial.flush();
+#endif
+}
+
+static bool started;
+
+#ifdef TARGET_NATIVE
+void console_init(void) {
+  if (started) {
+    return;
+  }
+  started = true;
+  // what's still queued when main() returns or exit() is called
+  atexit(console_flush);
+  std::thread([]() {
+    for (;;) {
+      if (!drain()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+    }
+  }).detach();
+}
+#else
+static void writer(void* param) {
+  for (;;) {
+    if (!drain()) {
+      vTaskDelay(pdMS_TO_TICKS(5));
+    }
+  }
 }
 
-#endif
\ No newline at end of file
+void console_init(void) {
+  if (started) {
+    return;
+  }
+  started = true;
+  // lowest priority, the UART waits don't hold anyone up
+  xTaskCreatePinnedToCore(writer, "console", 3072, NULL, 1, NULL, 0);
+}
+#endif
@@ -7,4 +7,41 @@
 # include <Arduino.h>
 #endif
 
+/**
+ * Deferred logging: the caller only copies the format pointer and its
+ * arguments into a lock-free queue, a background task (a thread on
+ * native) formats them and writes to the serial port. Messages are
+ * dropped rather than waited for when the queue is full.
+ *
+ * The format must be a string literal, %s arguments are copied.
+ */
+
+#define CONSOLE_ERROR 0
+#define CONSOLE_WARN  1
+#define CONSOLE_INFO  2
+#define CONSOLE_DEBUG 3
+
+// Messages above this level are compiled out
+#ifndef CONSOLE_LEVEL
+# define CONSOLE_LEVEL CONSOLE_INFO
+#endif
+
+#define CONSOLE_SLOTS 16    // queued messages
+#define CONSOLE_ARGS 8      // arguments per message
+#define CONSOLE_TEXT 160    // bytes of copied strings per message
+
+#define console_log(level, ...) \
+  do { if ((level) <= CONSOLE_LEVEL) console_printf(__VA_ARGS__); } while (0)
+#define console_error(...) console_log(CONSOLE_ERROR, __VA_ARGS__)
+#define console_warn(...) console_log(CONSOLE_WARN, __VA_ARGS__)
+#define console_info(...) console_log(CONSOLE_INFO, __VA_ARGS__)
+#define console_debug(...) console_log(CONSOLE_DEBUG, __VA_ARGS__)
+
+// Starts the writer; messages queued before are kept
+void console_init(void);
+
 void console_printf(const char* fmt, ...);
+
+// Writes all queued messages now, e.g. before a restart or sleep; waits
+// up to half a second for the writer
+void console_flush(void);
@@ -0,0 +1,268 @@
+/**
+ * Breakpoints, write watchpoints and stepping.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger.h"
+#include "profiler.h"
+#include "screen.h"
+
+static uint8_t* breaks;       // one bit per address
+static uint32_t breakSize;    // addresses covered by breaks
+static int breakCount;
+
+static uint16_t watchFrom[DEBUG_WATCHES];
+static uint16_t watchTo[DEBUG_WATCHES];
+static int watchCount;
+
+static bool paused;
+static debug_reason reason;
+static bool stepping;         // pause after the next instruction
+static bool stepOver;         // pause when pc reaches overAddr with rp <= overDepth
+static uint16_t overAddr;
+static int overDepth;
+static bool resumed;          // don't break at the pc we resumed from
+static uint32_t stops;        // times the program was paused
+static uint32_t changes;      // to breaks, watches or the paused state
+static bool cut;              // a pause cut the frame short
+static int done;              // instructions of it that ran
+
+void debug_reset(uint32_t ramSize) {
+  free(breaks);
+  breaks = NULL;
+  breakSize = ramSize;
+  breakCount = 0;
+  watchCount = 0;
+  paused = stepping = stepOver = resumed = false;
+  reason = DEBUG_NONE;
+  cut = false;
+  done = 0;
+  changes++;
+}
+
+bool debug_armed(void) {
+  return breakCount || watchCount || paused || stepping || stepOver;
+}
+
+bool debug_paused(void) {
+  return paused;
+}
+
+uint32_t debug_stops(void) {
+  return stops;
+}
+
+uint32_t debug_changes(void) {
+  return changes;
+}
+
+debug_reason debug_why(void) {
+  return reason;
+}
+
+const char* debug_reason_name(debug_reason r) {
+  switch (r) {
+    case DEBUG_BREAK:
+      return "break";
+    case DEBUG_WATCH:
+      return "watch";
+    case DEBUG_STEP:
+      return "step";
+    case DEBUG_USER:
+      return "pause";
+    default:
+      return "run";
+  }
+}
+
+bool debug_is_break(uint16_t addr) {
+  return breaks && addr < breakSize && (breaks[addr >> 3] >> (addr & 7)) & 1;
+}
+
+bool debug_toggle_break(uint16_t addr) {
+  if (addr >= breakSize) {
+    return false;
+  }
+  if (!breaks) {
+    uint8_t* b = (uint8_t*)calloc(breakSize / 8, 1);
+    if (!b) {
+      return false;
+    }
+    breaks = b;
+  }
+  breaks[addr >> 3] ^= 1 << (addr & 7);
+  breakCount += debug_is_break(addr) ? 1 : -1;
+  changes++;
+  return true;
+}
+
+void debug_clear_breaks(void) {
+  if (breaks) {
+    memset(breaks, 0, breakSize / 8);
+  }
+  breakCount = 0;
+  changes++;
+}
+
+int debug_breaks(uint16_t* addrs, int max) {
+  int n = 0;
+  for (uint32_t addr = 0; breaks && addr < breakSize && n < max; addr += 8) {
+    if (!breaks[addr >> 3]) {
+      continue;
+    }
+    for (uint32_t a = addr; a < addr + 8 && n < max; a++) {
+      if (debug_is_break(a)) {
+        addrs[n++] = a;
+      }
+    }
+  }
+  return n;
+}
+
+bool debug_watch(uint16_t from, uint16_t to) {
+  if (watchCount == DEBUG_WATCHES || to < from) {
+    return false;
+  }
+  watchFrom[watchCount] = from;
+  watchTo[watchCount] = to;
+  watchCount++;
+  changes++;
+  return true;
+}
+
+void debug_clear_watches(void) {
+  watchCount = 0;
+  changes++;
+}
+
+int debug_watches(uint16_t* from, uint16_t* to, int max) {
+  int n;
+  for (n = 0; n < watchCount && n < max; n++) {
+    from[n] = watchFrom[n];
+    to[n] = watchTo[n];
+  }
+  return n;
+}
+
+void debug_pause(void) {
+  if (!paused) {
+    stops++;
+  }
+  paused = true;
+  reason = DEBUG_USER;
+  changes++;
+}
+
+void debug_continue(void) {
+  if (paused) {
+    paused = false;
+    resumed = true;
+    reason = DEBUG_NONE;
+    changes++;
+  }
+}
+
+void debug_step(void) {
+  debug_continue();
+  stepping = true;
+}
+
+void debug_step_over(const octo_emulator* emu) {
+  uint16_t pc = emu->pc;
+  if ((emu->ram[pc] & 0xF0) != 0x20) {
+    debug_step();
+    return;
+  }
+  debug_continue();
+  stepOver = true;
+  overAddr = pc + 2;
+  overDepth = emu->rp;
+}
+
+// Range of RAM written by the instruction at pc, false if it doesn't write
+static bool writes(const octo_emulator* emu, uint16_t* from, uint16_t* to) {
+  uint16_t pc = emu->pc;
+  uint8_t hi = emu->ram[pc], lo = emu->ram[(uint16_t)(pc + 1)];
+  int x = hi & 0xF, y = lo >> 4;
+
+  if ((hi & 0xF0) == 0xF0 && lo == 0x55) {
+    *from = emu->i;
+    *to = emu->i + x;
+    return true;
+  }
+  if ((hi & 0xF0) == 0xF0 && lo == 0x33) {
+    *from = emu->i;
+    *to = emu->i + 2;
+    return true;
+  }
+  if ((hi & 0xF0) == 0x50 && (lo & 0xF) == 0x2) {
+    *from = emu->i;
+    *to = emu->i + (x > y ? x - y : y - x);
+    return true;
+  }
+  return false;
+}
+
+static bool watched(const octo_emulator* emu) {
+  uint16_t from, to;
+  if (!watchCount || !writes(emu, &from, &to)) {
+    return false;
+  }
+  for (int n = 0; n < watchCount; n++) {
+    if (from <= watchTo[n] && to >= watchFrom[n]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void stop(debug_reason r) {
+  stops++;
+  paused = true;
+  reason = r;
+  stepping = stepOver = false;
+  changes++;
+}
+
+bool debug_midframe(void) {
+  return cut;
+}
+
+bool debug_run(octo_emulator* emu, int cycles) {
+  int z;
+  for (z = done; z < cycles && !emu->halt && !paused; z++) {
+    uint16_t pc = emu->pc;
+
+    if (stepOver && pc == overAddr && emu->rp <= overDepth) {
+      stop(DEBUG_STEP);
+      break;
+    }
+    if (!resumed && breakCount && debug_is_break(pc)) {
+      stop(DEBUG_BREAK);
+      break;
+    }
+    resumed = false;
+
+    if (emu->options.q_vblank && (emu->ram[pc] & 0xF0) == 0xD0) {
+      z = cycles;
+    }
+    bool hit = watched(emu);
+    if (profile_enabled()) {
+      profile_instruction(emu);
+    }
+    screen_instruction(emu);
+
+    if (hit) {
+      stop(DEBUG_WATCH);
+    }
+    else
+    if (stepping) {
+      stop(DEBUG_STEP);
+    }
+  }
+  // z counts what ran, the instruction a break stopped at didn't
+  cut = paused && z < cycles && !emu->halt;
+  done = cut ? z : 0;
+  return cut;
+}
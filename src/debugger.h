@@ -0,0 +1,60 @@
+/**
+ * Breakpoints, write watchpoints and stepping.
+ *
+ * emu_step() only calls debug_run() while something is armed, otherwise it
+ * runs the plain interpreter loop without any checks.
+ */
+#ifndef _DEBUGGER_H
+#define _DEBUGGER_H
+
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#define DEBUG_WATCHES 4
+
+enum debug_reason {
+  DEBUG_NONE,
+  DEBUG_BREAK,
+  DEBUG_WATCH,
+  DEBUG_STEP,
+  DEBUG_USER
+};
+
+// Clears breakpoints, watchpoints and the paused state for a new program
+// using addresses below ramSize (4 KB or 64 KB)
+void debug_reset(uint32_t ramSize);
+
+// Breakpoints, watchpoints or a step are pending
+bool debug_armed(void);
+bool debug_paused(void);
+// Counts the pauses, a step pauses again before the caller sees it running
+uint32_t debug_stops(void);
+// Counts changes to breakpoints, watchpoints and the paused state
+uint32_t debug_changes(void);
+debug_reason debug_why(void);
+const char* debug_reason_name(debug_reason reason);
+
+bool debug_toggle_break(uint16_t addr);
+bool debug_is_break(uint16_t addr);
+void debug_clear_breaks(void);
+int debug_breaks(uint16_t* addrs, int max);
+
+// Pauses after an instruction wrote to [from, to]
+bool debug_watch(uint16_t from, uint16_t to);
+void debug_clear_watches(void);
+int debug_watches(uint16_t* from, uint16_t* to, int max);
+
+void debug_pause(void);
+void debug_continue(void);
+void debug_step(void);
+// Like debug_step(), but runs a call until it returns
+void debug_step_over(const octo_emulator* emu);
+
+// A pause cut the last frame short, debug_run() continues it
+bool debug_midframe(void);
+
+// Runs up to cycles instructions honouring breakpoints. Returns true if
+// a pause cut the frame short; the next call runs the rest of it.
+bool debug_run(octo_emulator* emu, int cycles);
+
+#endif
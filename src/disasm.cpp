@@ -0,0 +1,211 @@
+/**
+ * Table-driven CHIP-8 / SCHIP / XO-CHIP disassembler.
+ *
+ * Each opcode is a mask/match pattern with a format string. Upper-case
+ * letters in the format are operand extractors, everything else is copied:
+ *   X, Y, N  second, third, fourth nibble as one hex digit
+ *   B        low byte as two hex digits
+ *   A        12-bit address as three hex digits
+ *   L        the following word as four hex digits ("ld i,long")
+ */
+#include "disasm.h"
+
+struct Opcode {
+  uint16_t mask;
+  uint16_t match;
+  uint8_t size;
+  const char* fmt;
+};
+
+// Sorted by the first nibble, the more specific patterns first
+static constexpr Opcode OPCODES[] = {
+  { 0xFFFF, 0x00E0, 2, "cls" },
+  { 0xFFFF, 0x00EE, 2, "ret" },
+  { 0xFFF0, 0x00C0, 2, "scd N" },
+  { 0xFFF0, 0x00D0, 2, "scu N" },
+  { 0xFFFF, 0x00FB, 2, "scr" },
+  { 0xFFFF, 0x00FC, 2, "scl" },
+  { 0xFFFF, 0x00FD, 2, "exit" },
+  { 0xFFFF, 0x00FE, 2, "lores" },
+  { 0xFFFF, 0x00FF, 2, "hires" },
+  { 0xF000, 0x0000, 2, "sys A" },
+  { 0xF000, 0x1000, 2, "jp A" },
+  { 0xF000, 0x2000, 2, "call A" },
+  { 0xF000, 0x3000, 2, "se vX,B" },
+  { 0xF000, 0x4000, 2, "sne vX,B" },
+  { 0xF00F, 0x5000, 2, "se vX,vY" },
+  { 0xF00F, 0x5002, 2, "ld [i],vX-vY" },
+  { 0xF00F, 0x5003, 2, "ld vX-vY,[i]" },
+  { 0xF000, 0x6000, 2, "ld vX,B" },
+  { 0xF000, 0x7000, 2, "add vX,B" },
+  { 0xF00F, 0x8000, 2, "ld vX,vY" },
+  { 0xF00F, 0x8001, 2, "or vX,vY" },
+  { 0xF00F, 0x8002, 2, "and vX,vY" },
+  { 0xF00F, 0x8003, 2, "xor vX,vY" },
+  { 0xF00F, 0x8004, 2, "add vX,vY" },
+  { 0xF00F, 0x8005, 2, "sub vX,vY" },
+  { 0xF00F, 0x8006, 2, "shr vX,vY" },
+  { 0xF00F, 0x8007, 2, "subn vX,vY" },
+  { 0xF00F, 0x800E, 2, "shl vX,vY" },
+  { 0xF00F, 0x9000, 2, "sne vX,vY" },
+  { 0xF000, 0xA000, 2, "ld i,A" },
+  { 0xF000, 0xB000, 2, "jp v0,A" },
+  { 0xF000, 0xC000, 2, "rnd vX,B" },
+  { 0xF000, 0xD000, 2, "drw vX,vY,N" },
+  { 0xF0FF, 0xE09E, 2, "skp vX" },
+  { 0xF0FF, 0xE0A1, 2, "sknp vX" },
+  { 0xFFFF, 0xF000, 4, "ld i,long L" },
+  { 0xF0FF, 0xF001, 2, "plane X" },
+  { 0xFFFF, 0xF002, 2, "audio" },
+  { 0xF0FF, 0xF007, 2, "ld vX,dt" },
+  { 0xF0FF, 0xF00A, 2, "ld vX,k" },
+  { 0xF0FF, 0xF015, 2, "ld dt,vX" },
+  { 0xF0FF, 0xF018, 2, "ld st,vX" },
+  { 0xF0FF, 0xF01E, 2, "add i,vX" },
+  { 0xF0FF, 0xF029, 2, "ld f,vX" },
+  { 0xF0FF, 0xF030, 2, "ld hf,vX" },
+  { 0xF0FF, 0xF033, 2, "ld b,vX" },
+  { 0xF0FF, 0xF03A, 2, "pitch vX" },
+  { 0xF0FF, 0xF055, 2, "ld [i],vX" },
+  { 0xF0FF, 0xF065, 2, "ld vX,[i]" },
+  { 0xF0FF, 0xF075, 2, "ld r,vX" },
+  { 0xF0FF, 0xF085, 2, "ld vX,r" },
+};
+
+static constexpr uint8_t OPCODE_COUNT = sizeof(OPCODES) / sizeof(OPCODES[0]);
+
+static_assert(OPCODE_COUNT < DISASM_DATA, "too many opcodes for a token");
+
+constexpr bool isSorted(uint8_t i = 1) {
+  return i >= OPCODE_COUNT ||
+    ((OPCODES[i - 1].match >> 12) <= (OPCODES[i].match >> 12) && isSorted(i + 1));
+}
+
+static_assert(isSorted(), "OPCODES must be sorted by the first nibble");
+
+// Index of the first pattern whose first nibble is >= op
+constexpr uint8_t firstOf(uint8_t op, uint8_t i = 0) {
+  return i >= OPCODE_COUNT || (OPCODES[i].match >> 12) >= op ? i : firstOf(op, i + 1);
+}
+
+// Patterns for first nibble op are OPCODES[BUCKET[op]] .. OPCODES[BUCKET[op + 1] - 1]
+static constexpr uint8_t BUCKET[17] = {
+  firstOf(0x0), firstOf(0x1), firstOf(0x2), firstOf(0x3),
+  firstOf(0x4), firstOf(0x5), firstOf(0x6), firstOf(0x7),
+  firstOf(0x8), firstOf(0x9), firstOf(0xA), firstOf(0xB),
+  firstOf(0xC), firstOf(0xD), firstOf(0xE), firstOf(0xF),
+  OPCODE_COUNT
+};
+
+static const char HEX[] = "0123456789ABCDEF";
+
+static inline uint16_t word(const uint8_t* ram, uint16_t addr) {
+  return (ram[addr] << 8) | ram[(uint16_t)(addr + 1)];
+}
+
+char* disasm_hex(char* p, uint16_t value, int n) {
+  for (int shift = (n - 1) * 4; shift >= 0; shift -= 4) {
+    *p++ = HEX[(value >> shift) & 0xF];
+  }
+  return p;
+}
+
+uint8_t disasm_token(const uint8_t* ram, uint16_t addr) {
+  uint16_t wd = word(ram, addr);
+  uint8_t op = wd >> 12;
+
+  for (uint8_t t = BUCKET[op]; t < BUCKET[op + 1]; t++) {
+    if ((wd & OPCODES[t].mask) == OPCODES[t].match) {
+      return t;
+    }
+  }
+  return DISASM_UNKNOWN;
+}
+
+uint8_t disasm_length(uint8_t token) {
+  return token < OPCODE_COUNT ? OPCODES[token].size : 2;
+}
+
+size_t disasm_format(uint8_t token, const uint8_t* ram, uint16_t addr, char* buf) {
+  char* p = buf;
+
+  if (token < OPCODE_COUNT) {
+    uint16_t wd = word(ram, addr);
+
+    for (const char* f = OPCODES[token].fmt; *f; f++) {
+      switch (*f) {
+        case 'X':
+          *p++ = HEX[(wd >> 8) & 0xF];
+          break;
+        case 'Y':
+          *p++ = HEX[(wd >> 4) & 0xF];
+          break;
+        case 'N':
+          *p++ = HEX[wd & 0xF];
+          break;
+        case 'B':
+          p = disasm_hex(p, wd & 0xFF, 2);
+          break;
+        case 'A':
+          p = disasm_hex(p, wd & 0xFFF, 3);
+          break;
+        case 'L':
+          p = disasm_hex(p, word(ram, addr + 2), 4);
+          break;
+        default:
+          *p++ = *f;
+      }
+    }
+  }
+  *p = '\0';
+  return p - buf;
+}
+
+size_t disasm_data(const uint8_t* ram, uint16_t addr, uint8_t size, char* buf) {
+  char* p = buf;
+
+  *p++ = 'd';
+  *p++ = 'b';
+  for (uint8_t n = 0; n < size; n++) {
+    *p++ = ' ';
+    p = disasm_hex(p, ram[(uint16_t)(addr + n)], 2);
+  }
+  *p = '\0';
+  return p - buf;
+}
+
+size_t disasm_instr(const uint8_t* ram, uint16_t addr, char* buf) {
+  return disasm_format(disasm_token(ram, addr), ram, addr, buf);
+}
+
+size_t disasm_line(const uint8_t* ram, uint16_t addr, char* buf, uint8_t* size) {
+  uint8_t token = disasm_token(ram, addr);
+  char* p = buf;
+
+  p = disasm_hex(p, addr, 4);
+  *p++ = ':';
+  *p++ = ' ';
+  p = disasm_hex(p, word(ram, addr), 4);
+  *p++ = ' ';
+  p += disasm_format(token, ram, addr, p);
+  *p++ = '\n';
+  *p = '\0';
+
+  if (size) {
+    *size = disasm_length(token);
+  }
+  return p - buf;
+}
+
+size_t disasm_range(const uint8_t* ram, uint32_t from, uint32_t to, char* buf, size_t bufSize) {
+  size_t len = 0;
+  uint8_t size;
+
+  for (uint32_t addr = from; addr < to; addr += size) {
+    if (bufSize - len < DISASM_LINE_MAX) {
+      break;
+    }
+    len += disasm_line(ram, addr, buf + len, &size);
+  }
+  return len;
+}
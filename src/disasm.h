@@ -0,0 +1,50 @@
+/**
+ * Table-driven CHIP-8 / SCHIP / XO-CHIP disassembler.
+ *
+ * All functions write into caller-provided buffers and are reentrant.
+ */
+#ifndef _DISASM_H
+#define _DISASM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest mnemonic incl. terminating '\0' ("ld i,long FFFF")
+#define DISASM_MAX 16
+// Most bytes shown in one data line
+#define DISASM_DATA_MAX 8
+// Longest line incl. '\n' and '\0' ("FFFF: db 00 11 22 33 44 55 66 77")
+#define DISASM_LINE_MAX (11 + 3 * DISASM_DATA_MAX)
+
+// Token of words that don't match any opcode
+const uint8_t DISASM_UNKNOWN = 0xFF;
+// Token of bytes that aren't code (see flow.h)
+const uint8_t DISASM_DATA = 0xFE;
+
+// Index of the opcode pattern matching the word at addr (or DISASM_UNKNOWN)
+uint8_t disasm_token(const uint8_t* ram, uint16_t addr);
+
+// Size of the instruction in bytes (2, or 4 for "ld i,long")
+uint8_t disasm_length(uint8_t token);
+
+// Writes the mnemonic of an already decoded token, returns its length
+size_t disasm_format(uint8_t token, const uint8_t* ram, uint16_t addr, char* buf);
+
+// Writes the mnemonic of the instruction at addr, returns its length
+size_t disasm_instr(const uint8_t* ram, uint16_t addr, char* buf);
+
+// Writes "AAAA: WWWW mnemonic\n", returns its length. *size receives the
+// number of bytes the instruction occupies.
+size_t disasm_line(const uint8_t* ram, uint16_t addr, char* buf, uint8_t* size = NULL);
+
+// Disassembles [from, to) line by line into buf. Stops early if the next
+// line doesn't fit, returns the number of characters written.
+size_t disasm_range(const uint8_t* ram, uint32_t from, uint32_t to, char* buf, size_t bufSize);
+
+// Writes "db XX XX ..." for size bytes at addr, returns its length
+size_t disasm_data(const uint8_t* ram, uint16_t addr, uint8_t size, char* buf);
+
+// Writes n upper-case hex digits of value, returns the end of the written digits
+char* disasm_hex(char* p, uint16_t value, int n);
+
+#endif
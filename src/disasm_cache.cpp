@@ -0,0 +1,228 @@
+/**
+ * Disassembly of the loaded ROM, decoded once and kept up to date.
+ *
+ * The web server reads it while loop() rebuilds or edits it, every entry
+ * point holds the lock. The flow analysis is only used from here, under
+ * the same lock.
+ */
+#include <stdlib.h>
+#include <mutex>
+
+#include "console.h"
+#include "disasm_cache.h"
+#include "flow.h"
+
+static std::recursive_mutex lock;
+
+static uint16_t* lineAddr;
+static uint16_t* lineWord;
+static uint8_t* lineToken;
+static int lines;
+static int capacity;
+static uint32_t end;
+
+static inline uint16_t word(const uint8_t* ram, uint16_t addr) {
+  return (ram[addr] << 8) | ram[(uint16_t)(addr + 1)];
+}
+
+// Bytes up to the next instruction, at most one data line
+static uint8_t dataSize(uint32_t addr) {
+  uint8_t size = 1;
+  while (size < DISASM_DATA_MAX && addr + size < end && !flow_is_code(addr + size)) {
+    size++;
+  }
+  return size;
+}
+
+// Decodes lines from line (starting at addr) up to the end of the cached range
+static void layout(const uint8_t* ram, int line, uint32_t addr) {
+  bool flow = flow_valid();
+
+  while (addr < end && line < capacity) {
+    lineAddr[line] = addr;
+    lineWord[line] = word(ram, addr);
+    if (flow && !flow_is_code(addr)) {
+      lineToken[line] = DISASM_DATA;
+      addr += dataSize(addr);
+    }
+    else {
+      uint8_t token = disasm_token(ram, addr);
+      lineToken[line] = token;
+      addr += disasm_length(token);
+    }
+    line++;
+  }
+  lines = line;
+}
+
+static uint8_t lineSize(int line) {
+  uint32_t next = line + 1 < lines ? lineAddr[line + 1] : end;
+  return next - lineAddr[line];
+}
+
+void disasm_cache_clear(void) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  free(lineAddr);
+  free(lineWord);
+  free(lineToken);
+  lineAddr = lineWord = NULL;
+  lineToken = NULL;
+  lines = capacity = 0;
+}
+
+bool disasm_cache_build(const uint8_t* ram, uint16_t from, uint32_t to) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  disasm_cache_clear();
+  if (!flow_analyse(ram, from, to)) {
+    console_printf("No memory for flow analysis\r\n");
+  }
+  if (to <= from) {
+    return true;
+  }
+
+  // every instruction is at least one word long and data lines are
+  // separated by instructions unless they are full
+  capacity = flow_valid() ? 2 * (to - from) / 3 + 2 : (to - from + 1) / 2;
+  lineAddr = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+  lineWord = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+  lineToken = (uint8_t*)malloc(capacity);
+  if (!lineAddr || !lineWord || !lineToken) {
+    disasm_cache_clear();
+    return false;
+  }
+
+  end = to;
+  layout(ram, 0, from);
+  return true;
+}
+
+// Index of the line that contains addr, -1 if outside of the cache
+static int lineOf(uint16_t addr) {
+  if (!lines || addr < lineAddr[0] || addr >= end) {
+    return -1;
+  }
+  int lo = 0, hi = lines - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (lineAddr[mid] <= addr) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+static void refresh(const uint8_t* ram, int line) {
+  if (lineToken[line] == DISASM_DATA) {
+    // data is formatted straight from RAM
+    return;
+  }
+  uint16_t addr = lineAddr[line];
+  uint8_t token = disasm_token(ram, addr);
+
+  if (disasm_length(token) != disasm_length(lineToken[line])) {
+    // a long instruction appeared or vanished, the following lines move
+    layout(ram, line, addr);
+    return;
+  }
+  lineWord[line] = word(ram, addr);
+  lineToken[line] = token;
+}
+
+void disasm_cache_update(const uint8_t* ram, uint16_t addr) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  int line = lineOf(addr);
+  if (line < 0) {
+    return;
+  }
+  // typed in by hand, so it's meant as code, and so is what it leads to;
+  // a new jump or call may also turn data before the line into code
+  uint16_t from = lineToken[line] == DISASM_DATA ? addr : lineAddr[line];
+  if (flow_follow(ram, from) != 0) {
+    layout(ram, 0, lineAddr[0]);
+    return;
+  }
+  refresh(ram, line);
+}
+
+int disasm_cache_lines(void) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  return lines;
+}
+
+int disasm_cache_find(uint16_t addr) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  int line = lineOf(addr);
+  return line >= 0 && lineAddr[line] == addr ? line : -1;
+}
+
+uint16_t disasm_cache_addr(int line) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  return line >= 0 && line < lines ? lineAddr[line] : 0;
+}
+
+// Token of a line, re-decoded if the program overwrote it since
+static uint8_t tokenOf(const uint8_t* ram, int line) {
+  if (lineToken[line] != DISASM_DATA && lineWord[line] != word(ram, lineAddr[line])) {
+    refresh(ram, line);
+  }
+  return lineToken[line];
+}
+
+size_t disasm_cache_instr(const uint8_t* ram, int line, char* buf) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (line < 0 || line >= lines) {
+    *buf = '\0';
+    return 0;
+  }
+  uint8_t token = tokenOf(ram, line);
+  if (token == DISASM_DATA) {
+    return disasm_data(ram, lineAddr[line], lineSize(line), buf);
+  }
+  return disasm_format(token, ram, lineAddr[line], buf);
+}
+
+size_t disasm_cache_range(const uint8_t* ram, int first, int count, char* buf, size_t bufSize) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  size_t len = 0;
+
+  for (int line = first; line < first + count && line < lines; line++) {
+    if (bufSize - len < DISASM_LINE_MAX) {
+      break;
+    }
+    uint8_t token = tokenOf(ram, line);
+    uint16_t addr = lineAddr[line];
+    char* p = buf + len;
+
+    p = disasm_hex(p, addr, 4);
+    *p++ = ':';
+    *p++ = ' ';
+    if (token == DISASM_DATA) {
+      p += disasm_data(ram, addr, lineSize(line), p);
+    }
+    else {
+      p = disasm_hex(p, lineWord[line], 4);
+      *p++ = ' ';
+      p += disasm_format(token, ram, addr, p);
+    }
+    *p++ = '\n';
+    *p = '\0';
+    len = p - buf;
+  }
+  return len;
+}
+
+size_t disasm_cached_instr(const uint8_t* ram, uint16_t addr, char* buf) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  int line = disasm_cache_find(addr);
+  if (line >= 0 && lineToken[line] != DISASM_DATA) {
+    return disasm_cache_instr(ram, line, buf);
+  }
+  if (line >= 0 || flow_is_data(addr)) {
+    // the monitor shows data a word at a time
+    return disasm_data(ram, addr, 2, buf);
+  }
+  return disasm_instr(ram, addr, buf);
+}
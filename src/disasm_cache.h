@@ -0,0 +1,45 @@
+/**
+ * Disassembly of the loaded ROM, decoded once and kept up to date.
+ *
+ * The cache stores the start address, the word and the opcode token of each
+ * line. If the ROM was analysed (flow.h), bytes outside of reachable code
+ * are grouped into data lines. Edits are applied with disasm_cache_update();
+ * writes by the running program are picked up when a line is accessed, so
+ * only lines that are actually shown are ever re-decoded.
+ *
+ * Every function locks, the web server reads the cache while loop()
+ * rebuilds or edits it.
+ */
+#ifndef _DISASM_CACHE_H
+#define _DISASM_CACHE_H
+
+#include "disasm.h"
+
+// Analyses (flow.h) and decodes [from, to). Returns false (and leaves
+// the cache empty) if out of memory.
+bool disasm_cache_build(const uint8_t* ram, uint16_t from, uint32_t to);
+
+void disasm_cache_clear(void);
+
+// Re-decodes the line containing addr after it was edited. An edit in
+// data, or one that jumps there, makes code of it and what it reaches.
+void disasm_cache_update(const uint8_t* ram, uint16_t addr);
+
+int disasm_cache_lines(void);
+
+// Line starting exactly at addr, -1 if addr is not the start of a cached line
+int disasm_cache_find(uint16_t addr);
+
+// Start of line, 0 if the cache changed and it's gone
+uint16_t disasm_cache_addr(int line);
+
+// Writes the mnemonic of a line, returns its length
+size_t disasm_cache_instr(const uint8_t* ram, int line, char* buf);
+
+// Writes lines [first, first + count) like disasm_range(), returns the number of characters
+size_t disasm_cache_range(const uint8_t* ram, int first, int count, char* buf, size_t bufSize);
+
+// Mnemonic of the instruction at addr, from the cache if possible
+size_t disasm_cached_instr(const uint8_t* ram, uint16_t addr, char* buf);
+
+#endif
@@ -3,7 +3,17 @@
  */ 
 #define LGFX_USE_V1
 
+#include <ctype.h>
+#include <limits.h>
 #include <string.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#ifdef TARGET_NATIVE
+# include <thread>
+#else
+# include "esp_system.h"
+#endif
 #include <LovyanGFX.hpp>
 #include <lgfx/v1/LGFX_Button.hpp>
 #include <SPI.h>
@@ -13,7 +23,23 @@
 #include <ESPAsyncWebServer.h>
 #include <octo_emulator.h>
 
+#include "aot.h"
+#include "audio.h"
+#include "catalog.h"
 #include "console.h"
+#include "debugger.h"
+#include "disasm_cache.h"
+#include "idle.h"
+#include "latency.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rewind.h"
+#include "romdb.h"
+#include "screen.h"
+#include "snapshot.h"
+#include "text.h"
+#include "thumbs.h"
+#include "touch.h"
 #include "credentials.h"
 
 class LGFX : public lgfx::LGFX_Device
@@ -89,7 +115,7 @@ public:
       cfg.y_max = 3800;
 
       // --- Pinos ---
-      cfg.pin_int  = XPT2046_TOUCH_CONFIG_INT_GPIO_NUM;   // INT não usado (pode colocar se existir)
+      cfg.pin_int  = XPT2046_TOUCH_CONFIG_INT_GPIO_NUM;   // PENIRQ, see touch_init()
       cfg.pin_mosi   = XPT2046_SPI_BUS_MOSI_IO_NUM;
       cfg.pin_miso   = XPT2046_SPI_BUS_MISO_IO_NUM;
       cfg.pin_sclk   = XPT2046_SPI_BUS_SCLK_IO_NUM;
@@ -114,17 +140,103 @@ AsyncWebServer* server;
 const char* ssid = WLAN_SSID;
 const char* password = WLAN_PASS;
 
-char** prg;
-int prgCount = 0;
-int prgSpace = 0;
-int currPrg = 0;
+int currPrg = 0;             // index into the catalog
+const int FILES_PAGE = 50;    // programs per page of /files
 
 int ch8Size;
+char* loadedPath;   // path of the running program
+char* prgFile;      // its .ec8 contents (options added to a .ch8), the reference for snapshots
+
+const char* SESSION_PATH = "/session.rec";
+const char* RESUME_PATH = "/resume.snap";
+const char* THUMBS_PATH = "/thumbs.thm";
+
+const unsigned long SNAPSHOT_INTERVAL = 60000;  // ms at least between saves of a new program
+uint32_t snapshotHash;        // of the state in RESUME_PATH, 0 if not known
+unsigned long snapshotAt;     // millis() of the last save
+bool snapshotDue = false;     // a new program is running, not saved yet
 
 bool isMonitor = false;
+bool isLiveMonitor = false;   // the program keeps running while the monitor is shown
 uint16_t monitorAddr;
 uint8_t monitorNibble;
 
+bool redraw = false;          // repaint the display even if px didn't change
+bool isBrowsing = false;      // another program than the running one is selected
+
+const unsigned long LONG_PRESS = 400;   // ms to hold < (rewind), > (next initial), G (turbo) or M (save)
+const int REWIND_SPEED = 2;             // frames stepped back per tick
+bool isRewinding = false;
+unsigned long leftPressedAt;
+unsigned long rightPressedAt;
+
+const int TURBO_MAX = 32;     // frames per tick
+bool isTurbo = false;
+int turboFrames = 1;          // adapted to what fits into a tick
+bool goHeld = false;          // G was held and toggled turbo
+unsigned long goPressedAt;
+
+bool monitorDown = false;     // M was pressed outside the monitor
+bool monitorHeld = false;     // and held to save a snapshot
+unsigned long monitorPressedAt;
+
+uint32_t touchUs;             // micros() of the touch being handled, for the latency probe
+
+// What the web server asks for is done by loop() between frames, nothing
+// may change the program under the running interpreter
+enum {
+  OP_PROFILE_START = 1 << 0,
+  OP_PROFILE_STOP = 1 << 1,
+  OP_PROFILE_CLEAR = 1 << 2,
+  OP_PROFILE_SAVE = 1 << 3,
+  OP_RECORD_START = 1 << 4,
+  OP_RECORD_STOP = 1 << 5,
+  OP_REPLAY_START = 1 << 6,
+  OP_SNAPSHOT_SAVE = 1 << 7,
+  OP_SNAPSHOT_LOAD = 1 << 8,
+  OP_SNAPSHOT_DROP = 1 << 9,
+  OP_TURBO_ON = 1 << 10,
+  OP_TURBO_OFF = 1 << 11,
+  OP_TURBO_TOGGLE = 1 << 12,
+  OP_SELECT_LOADED = 1 << 13,     // the catalog changed
+  OP_COMMANDS = 1 << 14,          // webCmds holds some
+  OP_CATALOG_REBUILD = 1 << 15,
+  OP_LATENCY_ON = 1 << 16,
+  OP_LATENCY_OFF = 1 << 17,
+  OP_LATENCY_RESET = 1 << 18,
+  OP_RESTART = 1 << 19            // after everything else
+};
+std::atomic<uint32_t> pendingOps;
+
+// Commands with parameters, run by loop() in the order they came
+enum WebCmdOp : uint8_t {
+  CMD_BREAK,
+  CMD_CLEAR_BREAKS,
+  CMD_WATCH,
+  CMD_CLEAR_WATCHES,
+  CMD_PAUSE,
+  CMD_STEP,
+  CMD_STEP_OVER,
+  CMD_CONTINUE,
+  CMD_CATALOG_ADD,
+  CMD_CATALOG_REMOVE
+};
+struct WebCmd {
+  WebCmdOp op;
+  uint16_t from, to;
+  char name[CATALOG_NAME];
+};
+const int WEB_CMDS = 8;
+WebCmd webCmds[WEB_CMDS];
+int webCmdCount;
+String debugState;            // debugInfo() as of the last change, for /debug
+std::mutex webLock;           // webCmds and debugState
+
+#ifdef TARGET_NATIVE
+bool isUncapped = false;      // ESPOCTO_UNCAPPED: ticks back to back, for benchmarks
+unsigned long tickCount;
+#endif
+
 enum {
   PAGE_MAIN,
   PAGE_SAVE
@@ -145,6 +257,20 @@ static char lbl[20][2] = {
 
 static LGFX_Button btn[20];
 
+// 5x4 keypad: 36x36 keys, 42 pixels apart, the first centred at (36, 150)
+const int KEY_SIZE = 36;
+const int KEY_PITCH = 42;
+const int KEYPAD_X = 36 - KEY_SIZE / 2;
+const int KEYPAD_Y = 150 - KEY_SIZE / 2;
+const int KEYPAD_W = 4 * KEY_PITCH + KEY_SIZE;
+const int KEYPAD_H = 3 * KEY_PITCH + KEY_SIZE;
+
+// the whole keypad released and pressed, 2 bits per pixel
+static LGFX_Sprite keysUp(&lcd);
+static LGFX_Sprite keysDown(&lcd);
+
+static uint32_t pressedKeys;    // one bit per button
+
 octo_emulator* emu;
 
 const std::int8_t KEY_NONE = -1;
@@ -175,39 +301,158 @@ std::int8_t hexButton(std::uint8_t i) {
   else return KEY_NONE;
 }
 
-void drawButtons(void) {
+// Button under (x, y), -1 if none
+int keyAt(int x, int y) {
+  x -= KEYPAD_X;
+  y -= KEYPAD_Y;
+  if (x < 0 || y < 0 || x >= KEYPAD_W || y >= KEYPAD_H ||
+    x % KEY_PITCH >= KEY_SIZE || y % KEY_PITCH >= KEY_SIZE) {
+    return -1;
+  }
+  return 5 * (y / KEY_PITCH) + x / KEY_PITCH;
+}
+
+void initButtons(lgfx::LovyanGFX* gfx, int dx, int dy,
+  uint32_t outline, uint32_t fill, uint32_t text, uint32_t special) {
   for (int col = 0; col <= 4; col++) {
     for (int row = 0; row <= 3; row++) {
       int n = 5 * row + col;
 
-      btn[n].initButton(&lcd,
-        36 + col * 42,      // x
-        150 + row * 42,     // y
+      btn[n].initButton(gfx,
+        36 + col * 42 - dx, // x
+        150 + row * 42 - dy,// y
         36,                 // w
         36,                 // h
-        0xFFFFCC00u,        // outline
-        0xFF996600u,        // fill
-        col == 4 ? 0xFFFF6600u : 0xFFFFCC00u,
+        outline,            // outline
+        fill,               // fill
+        col == 4 ? special : text,
                             // textcolor
         lbl[n],             // label
         1.0,                // textsize x
         1.0                 // textsize y
       );
-      btn[n].drawButton();
     }
   }
 }
 
+// Renders both keypad states off-screen, false if there's no memory for it
+bool renderKeypad(void) {
+  LGFX_Sprite* keys[2] = { &keysUp, &keysDown };
+
+  for (int s = 0; s < 2; s++) {
+    keys[s]->setColorDepth(2);
+    if (!keys[s]->createSprite(KEYPAD_W, KEYPAD_H)) {
+      keysUp.deleteSprite();
+      return false;
+    }
+    keys[s]->setPaletteColor(0, 0xFF996600u);
+    keys[s]->setPaletteColor(1, 0xFFFFCC00u);
+    keys[s]->setPaletteColor(2, 0xFFFF6600u);
+    keys[s]->setPaletteColor(3, 0xFF000000u);
+    keys[s]->setFont(&fonts::FreeMonoBold12pt7b);
+    keys[s]->fillScreen(3);
+
+    // palette sprites take palette indices as colours
+    initButtons(keys[s], KEYPAD_X, KEYPAD_Y, 1, 0, 1, 2);
+    for (int n = 0; n < 20; n++) {
+      btn[n].drawButton(s == 1);
+    }
+  }
+  return true;
+}
+
+void drawKey(int n, bool pressed) {
+  if (!keysDown.getBuffer()) {
+    btn[n].drawButton(pressed);
+    return;
+  }
+  lcd.setClipRect(KEYPAD_X + (n % 5) * KEY_PITCH, KEYPAD_Y + (n / 5) * KEY_PITCH,
+    KEY_SIZE, KEY_SIZE);
+  (pressed ? keysDown : keysUp).pushSprite(KEYPAD_X, KEYPAD_Y);
+  lcd.clearClipRect();
+}
+
+void drawButtons(void) {
+  if (keysDown.getBuffer() || renderKeypad()) {
+    keysUp.pushSprite(KEYPAD_X, KEYPAD_Y);
+    return;
+  }
+  initButtons(&lcd, 0, 0, 0xFFFFCC00u, 0xFF996600u, 0xFFFFCC00u, 0xFFFF6600u);
+  for (int n = 0; n < 20; n++) {
+    btn[n].drawButton();
+  }
+}
+
+// Name of the selected program without its extension; the running one
+// until the catalog has been read
+void prgName(char* name, size_t size) {
+  char file[CATALOG_NAME];
+  const char* s = catalog_name(currPrg, file) ? file : loadedPath ? loadedPath + 1 : "";
+  strncpy(name, s, size - 1);
+  name[size - 1] = '\0';
+  char* p = strrchr(name, '.');
+  if (p) {
+    *p = '\0';
+  }
+}
+
+// Draws the thumbnail of name where the game goes
+void showPreview(const char* name) {
+  LGFX_Sprite preview(&lcd);
+  preview.setColorDepth(1);
+  if (!preview.createSprite(THUMB_WIDTH, THUMB_HEIGHT)) {
+    return;
+  }
+  preview.setPaletteColor(0, 0xFF996600u);
+  preview.setPaletteColor(1, 0xFFFFCC00u);
+  thumb_bits bits;
+  if (thumbs_find(name, bits)) {
+    // the same layout as a 1 bit sprite
+    memcpy(preview.getBuffer(), bits, sizeof(bits));
+  }
+  else {
+    preview.fillScreen(0);
+  }
+  preview.setPivot(THUMB_WIDTH / 2, 0);
+  preview.pushRotateZoom(lcd.width() / 2, 74, 0, 3 * 1.3, 3);
+  preview.deleteSprite();
+}
+
 void showCurrPrg(octo_emulator* emu) {
-  lcd.fillRect(0, 0, 240, 18, 0xFFFFCC00u);
+  char name[SNAPSHOT_PATH_MAX];
+  prgName(name, sizeof(name));
+
+  // the game gives way to previews while browsing
+  char file[CATALOG_NAME];
+  bool browsing = loadedPath && catalog_name(currPrg, file) && strcmp(file, loadedPath + 1) != 0;
+  if (browsing) {
+    showPreview(name);
+  }
+  else
+  if (isBrowsing) {
+    redraw = true;
+  }
+  isBrowsing = browsing;
+
+  LGFX_Sprite* bar = text_begin(240, 18);
+  if (!bar) {
+    lcd.fillRect(0, 0, 240, 18, 0xFFFFCC00u);
+    lcd.setTextColor(0xFF996600u, 0xFFFFCC00u);
+    lcd.drawNumber(emu->options.tickrate, 2, 0, &fonts::FreeMonoBold9pt7b);
+    lcd.drawCenterString(name, 120, 0, &fonts::FreeMonoBold9pt7b);
+    lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
+    return;
+  }
+  bar->drawNumber(emu->options.tickrate, 2, 0, &fonts::FreeMonoBold9pt7b);
+  bar->drawCenterString(name, 120, 0, &fonts::FreeMonoBold9pt7b);
+  text_push(0, 0, 0xFF996600u, 0xFFFFCC00u);
+}
 
-  lcd.setTextColor(0xFF996600u, 0xFFFFCC00u);
-  lcd.drawNumber(emu->options.tickrate, 2, 0, &fonts::FreeMonoBold9pt7b);
-  char* p = strrchr(prg[currPrg], '.');
-  *p = '\0';
-  lcd.drawCenterString(prg[currPrg], 120, 0, &fonts::FreeMonoBold9pt7b);
-  *p = '.';
-  lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
+void setTurbo(octo_emulator* emu, bool on) {
+  isTurbo = on;
+  turboFrames = 1;
+  lcd.fillCircle(230, 32, 4, on ? 0xFFFF6600u : 0xFF996600u);
+  console_printf("Turbo %s\r\n", on ? "on" : "off");
 }
 
 bool loadPrg(char* filename, octo_emulator* emu) {
@@ -215,19 +460,40 @@ bool loadPrg(char* filename, octo_emulator* emu) {
   if (!f) {
     return false;
   }
-  int size = f.size();
+  // a .ch8 is laid out like a .ec8, with options from the ROM database
+  size_t len = strlen(filename);
+  int head = len > 4 && strcmp(filename + len - 4, ".ch8") == 0 ? sizeof(octo_options) : 0;
+  int size = f.size() + head;
   char* info = (char*)malloc(size);
-  f.read((uint8_t*)info, size);
+  f.read((uint8_t*)info + head, size - head);
   f.close();
 
   ch8Size = size - sizeof(octo_options);
+  if (head && !romdb_options((uint8_t*)info + head, ch8Size, (octo_options*)info)) {
+    console_printf("Unknown ROM, default options\r\n");
+  }
   octo_emulator_init(emu, info + sizeof(octo_options), ch8Size, (octo_options*)info, NULL);
-  free(info);
+  screen_pack(emu);
+  redraw = true;
+  if (aot_attach((uint8_t*)info + sizeof(octo_options), ch8Size)) {
+    console_printf("Running translated code\r\n");
+  }
+  free(prgFile);
+  prgFile = info;
+
+  debug_reset(0x200 + ch8Size <= 0x1000 ? 0x1000 : 0x10000);
+  if (profile_enabled() && !profile_start(0x200, 0x200 + ch8Size)) {
+    console_printf("No memory for profiler\r\n");
+  }
+  if (!disasm_cache_build(emu->ram, 0x200, 0x200 + ch8Size)) {
+    console_printf("No memory for disassembly cache\r\n");
+  }
+  if (!rewind_start(emu, 0x200 + ch8Size)) {
+    console_printf("No memory for rewind\r\n");
+  }
 
   monitorAddr = 0x200;
   monitorNibble = 0;
-
-  showCurrPrg(emu);
   return true;
 }
 
@@ -242,380 +508,457 @@ bool savePrg(char* filename, octo_emulator* emu) {
   return true;
 }
 
-void loadCurrPrg(octo_emulator* emu) {
-  if (!prg || !prg[currPrg]) {
-    console_printf("DEBUG prg=%p currPrg=%d\r\n", prg, currPrg);
+// Loads the program at path and makes it the running one
+bool loadPath(const char* path, octo_emulator* emu) {
+  if (loadedPath && profile_enabled()) {
+    profile_save(loadedPath);
+  }
+  // path may be loadedPath itself
+  char* p = strdup(path);
+  if (!loadPrg(p, emu)) {
+    console_printf("Failed to load %s\r\n", path);
+    free(p);
+    return false;
+  }
+  console_printf("Loaded %s\r\n", path);
 
-    if (prg) {
-      for (int i = 0; i < 5; i++) {
-        console_printf("prg[%d]=%p\r\n", i, prg[i]);
-      }
-    }
+  free(loadedPath);
+  loadedPath = p;
+  showCurrPrg(emu);
+  return true;
+}
 
-    console_printf("Invalid program index\r\n");
-    return;
+// Tells the states of the running program apart
+uint32_t stateHash(const octo_emulator* emu) {
+  return romdb_hash((const uint8_t*)emu, sizeof(octo_emulator)) ^
+    romdb_hash((const uint8_t*)loadedPath, strlen(loadedPath));
+}
+
+// Saves the running program's state for the next boot, unless that's
+// what RESUME_PATH already holds
+bool saveSnapshot(octo_emulator* emu) {
+  if (!loadedPath) {
+    return false;
   }
+  unsigned long start = millis();
+  uint32_t hash = stateHash(emu);
+  snapshotDue = false;
+  snapshotAt = start;
+  if (hash == snapshotHash) {
+    console_debug("%s unchanged\r\n", RESUME_PATH);
+    return true;
+  }
+  bool ok = snapshot_save(emu, loadedPath,
+    (const uint8_t*)prgFile + sizeof(octo_options), ch8Size, RESUME_PATH);
+  snapshotHash = ok ? hash : 0;
+  console_printf("%s %s in %lu ms\r\n", ok ? "Saved" : "Failed to save",
+    RESUME_PATH, millis() - start);
+  return ok;
+}
 
-  char* path = (char*) malloc(10 + strlen(prg[currPrg]));
-  
-  strcpy(path, "/");
-  strcat(path, prg[currPrg]);
-  if (loadPrg(path, emu)) {
-    console_printf("Loaded %s\r\n", path);
+// Loads the program of the last snapshot and restores its state; a
+// snapshot that doesn't match the program leaves it freshly started
+bool resumeSnapshot(octo_emulator* emu) {
+  char path[SNAPSHOT_PATH_MAX];
+  int size;
+
+  unsigned long start = millis();
+  if (!snapshot_peek(RESUME_PATH, path, &size) || !loadPath(path, emu)) {
+    return false;
   }
-  else {
-    console_printf("Failed to load %s\r\n", path);
+  if (size != ch8Size ||
+    !snapshot_load(emu, (const uint8_t*)prgFile + sizeof(octo_options), ch8Size, RESUME_PATH)) {
+    console_printf("Snapshot of %s doesn't match, restarted\r\n", path);
+    loadPath(path, emu);
+    return true;
   }
-  free(path);
+  // the display is drawn from px, the sprite is drawn again in full
+  screen_pack(emu);
+  redraw = true;
+  rewind_start(emu, 0x200 + ch8Size);
+  showCurrPrg(emu);
+  snapshotHash = stateHash(emu);
+  console_printf("Resumed %s in %lu ms\r\n", path, millis() - start);
+  return true;
 }
 
-bool isValidEc8(const char* name) {
-  if (!name) return false;
+// Restarts the running program and records the session from its first frame
+void startRecording(octo_emulator* emu) {
+  if (!loadedPath || !loadPath(loadedPath, emu)) {
+    return;
+  }
+  uint32_t seed = micros();
+  srand(seed);
+  replay_record(loadedPath, seed);
+  console_printf("Recording %s, seed %u\r\n", loadedPath, (unsigned)seed);
+}
 
-  size_t len = strlen(name);
-  if (len < 4) return false;
+// Restarts the recorded program and plays the session back
+bool startReplay(const char* log, octo_emulator* emu) {
+  char rom[REPLAY_PATH_MAX];
+  uint32_t seed;
 
-  // termina com ".ec8"
-  return strcmp(name + len - 4, ".ec8") == 0;
+  if (!replay_load(log, rom, &seed) || !loadPath(rom, emu)) {
+    console_printf("Failed to replay %s\r\n", log);
+    return false;
+  }
+  srand(seed);
+  replay_play();
+  console_printf("Replaying %s\r\n", log);
+  return true;
 }
 
-void loadPrgInfo() {
-  File d = SPIFFS.open("/");
+// Selects the running program in the catalog, or a valid one
+void selectLoaded(void) {
+  int i = loadedPath ? catalog_index(loadedPath + 1) : -1;
+  if (i >= 0) {
+    currPrg = i;
+  }
+  else
+  if (currPrg >= catalog_count()) {
+    currPrg = catalog_count() > 0 ? catalog_count() - 1 : 0;
+  }
+}
 
-  if (!d) {
-    Serial.println("Failed to open directory!");
-    return; // OU trate o erro
+// Carries out what the web server asked for
+// JSON with the debugger state for /debug
+String debugInfo(octo_emulator* emu) {
+  char buf[8];
+  String json = "{\"state\":\"";
+  json += debug_reason_name(debug_paused() ? debug_why() : DEBUG_NONE);
+  json += "\",\"pc\":\"";
+  *disasm_hex(buf, emu->pc, 4) = '\0';
+  json += buf;
+  json += "\",\"breaks\":[";
+
+  uint16_t from[16], to[DEBUG_WATCHES];
+  int n = debug_breaks(from, 16);
+  for (int k = 0; k < n; k++) {
+    *disasm_hex(buf, from[k], 4) = '\0';
+    json += k ? ",\"" : "\"";
+    json += buf;
+    json += "\"";
+  }
+  json += "],\"watches\":[";
+  n = debug_watches(from, to, DEBUG_WATCHES);
+  for (int k = 0; k < n; k++) {
+    json += k ? ",[\"" : "[\"";
+    *disasm_hex(buf, from[k], 4) = '\0';
+    json += buf;
+    json += "\",\"";
+    *disasm_hex(buf, to[k], 4) = '\0';
+    json += buf;
+    json += "\"]";
   }
+  json += "]}";
+  return json;
+}
 
-  prg = (char**)malloc(30 * sizeof(char*));
-  prgSpace = 30;
+// Queues a command for loop(), false if too many are waiting
+bool queueCommand(WebCmdOp op, uint16_t from, uint16_t to, const char* name = "") {
+  std::lock_guard<std::mutex> guard(webLock);
+  if (webCmdCount == WEB_CMDS) {
+    return false;
+  }
+  WebCmd* cmd = &webCmds[webCmdCount++];
+  cmd->op = op;
+  cmd->from = from;
+  cmd->to = to;
+  strncpy(cmd->name, name, sizeof(cmd->name) - 1);
+  cmd->name[sizeof(cmd->name) - 1] = '\0';
+  pendingOps |= OP_COMMANDS;
+  return true;
+}
 
-  File f = d.openNextFile();
-  while (f) {
-    const char* name = f.name();
-    if (strcmp(name + strlen(name) - 4, ".ec8") != 0) {
-      f = d.openNextFile();
-      continue;
-    }
+// Keeps the catalog in step with a file written or removed, in loop();
+// rescans it if the queue is full
+void queueCatalog(WebCmdOp op, const char* name) {
+  if (!queueCommand(op, 0, 0, name)) {
+    pendingOps |= OP_CATALOG_REBUILD;
+  }
+}
 
-    if (prgSpace < ++prgCount) {
-      prgSpace += 30;
-      prg = (char**)realloc(prg, prgSpace * sizeof(char*));
+void runCommands(octo_emulator* emu) {
+  WebCmd cmds[WEB_CMDS];
+  int count;
+  {
+    std::lock_guard<std::mutex> guard(webLock);
+    count = webCmdCount;
+    memcpy(cmds, webCmds, count * sizeof(WebCmd));
+    webCmdCount = 0;
+  }
+  for (int n = 0; n < count; n++) {
+    switch (cmds[n].op) {
+      case CMD_BREAK:
+        debug_toggle_break(cmds[n].from);
+        break;
+      case CMD_CLEAR_BREAKS:
+        debug_clear_breaks();
+        break;
+      case CMD_WATCH:
+        debug_watch(cmds[n].from, cmds[n].to);
+        break;
+      case CMD_CLEAR_WATCHES:
+        debug_clear_watches();
+        break;
+      case CMD_PAUSE:
+        debug_pause();
+        break;
+      case CMD_STEP:
+        debug_step();
+        break;
+      case CMD_STEP_OVER:
+        debug_step_over(emu);
+        break;
+      case CMD_CONTINUE:
+        debug_continue();
+        break;
+      case CMD_CATALOG_ADD:
+        catalog_add(cmds[n].name);
+        selectLoaded();
+        break;
+      case CMD_CATALOG_REMOVE:
+        catalog_remove(cmds[n].name);
+        selectLoaded();
+        break;
     }
-
-    prg[prgCount - 1] = strdup(name);
-  
-    f = d.openNextFile();
   }
-  console_printf("%d files read.\r\n", prgCount);
 }
 
-#if 0
-#include <Arduino.h>
-#include <driver/i2s.h>
-
-#define AUDIO_FRAG_SIZE 1024
-#define AUDIO_SAMPLE_RATE (4096*8)
-
-// I2S Konfiguration
-#define I2S_NUM         (0) // I2S port number
-#define I2S_BCK_IO      (26) // Bit Clock Pin
-#define I2S_WS_IO       (25) // Word Select Pin
-#define I2S_DO_IO       (22) // Data Out Pin
-#define I2S_DI_IO       (-1) // Data In Pin, nicht verwendet
-
-void audio_pump(void *user, int16_t *stream, int len) {
-  octo_emulator *emu = (octo_emulator*)user;
-  double freq = 4000 * pow(2, (emu->pitch - 64) / 48.0);
-  for (int z = 0; z < len; z++) {
-    int ip = emu->osc;
-    stream[z] = !emu->had_sound ? 0 : (emu->pattern[ip >> 3] >> ((ip & 7) ^ 7)) & 1 ? INT16_MAX * ui.volume : 0;
-    emu->osc = fmod(emu->osc + (freq / AUDIO_SAMPLE_RATE), 128.0);
-  }
-  emu->had_sound = 0;
-}
-
-void audio_init(octo_emulator *emu) {
-  const i2s_config_t i2s_config = {
-    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-    .sample_rate = AUDIO_SAMPLE_RATE,
-    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT, // Mono-Ausgabe
-    .communication_format = I2S_COMM_FORMAT_I2S_MSB,
-    .intr_alloc_flags = 0, // Standard Interrupt Priority
-    .dma_buf_count = 8,
-    .dma_buf_len = AUDIO_FRAG_SIZE,
-    .use_apll = false,
-    .tx_desc_auto_clear = true, // Auto clear tx descriptor on underflow
-    .fixed_mclk = 0
-  };
-
-  const i2s_pin_config_t pin_config = {
-    .bck_io_num = I2S_BCK_IO,
-    .ws_io_num = I2S_WS_IO,
-    .data_out_num = I2S_DO_IO,
-    .data_in_num = I2S_DI_IO
-  };
-
-  // I2S Treiber installieren und Konfiguration für I2S port setzen
-  i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL);
-  i2s_set_pin(I2S_NUM, &pin_config);
-
-  // Optional: I2S Bits pro Sample und Kanal-Format einstellen
-  i2s_set_clk(I2S_NUM, AUDIO_SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
-}
-
-// Die audio_pump Funktion muss periodisch aufgerufen werden, um das Audiobuffer zu füllen.
-// Dies könnte in einem dedizierten Task oder in der main loop erfolgen, abhängig von der Struktur Ihrer Anwendung.
+void runPendingOps(octo_emulator* emu) {
+  uint32_t ops = pendingOps.exchange(0);
+  if (ops & OP_PROFILE_CLEAR) {
+    profile_clear();
+  }
+  if (ops & OP_PROFILE_START) {
+    profile_start(0x200, 0x200 + ch8Size);
+  }
+  if (ops & OP_PROFILE_STOP) {
+    profile_stop();
+  }
+  if ((ops & OP_PROFILE_SAVE) && loadedPath) {
+    profile_save(loadedPath);
+  }
+  if (ops & OP_RECORD_STOP) {
+    replay_save(SESSION_PATH);
+  }
+  if (ops & OP_RECORD_START) {
+    startRecording(emu);
+  }
+  if (ops & OP_REPLAY_START) {
+    startReplay(SESSION_PATH, emu);
+  }
+  if (ops & OP_SNAPSHOT_DROP) {
+    snapshot_remove(RESUME_PATH);
+    snapshotHash = 0;
+  }
+  if (ops & OP_SNAPSHOT_SAVE) {
+    saveSnapshot(emu);
+  }
+  if (ops & OP_SNAPSHOT_LOAD) {
+    resumeSnapshot(emu);
+  }
+  if (ops & (OP_TURBO_ON | OP_TURBO_OFF | OP_TURBO_TOGGLE)) {
+    setTurbo(emu, ops & OP_TURBO_TOGGLE ? !isTurbo : (ops & OP_TURBO_ON) != 0);
+  }
+  if (ops & OP_SELECT_LOADED) {
+    selectLoaded();
+  }
+  if (ops & OP_COMMANDS) {
+    runCommands(emu);
+  }
+  if (ops & OP_CATALOG_REBUILD) {
+    catalog_rebuild();
+    selectLoaded();
+  }
+  if (ops & (OP_LATENCY_ON | OP_LATENCY_OFF)) {
+    latency_enable((ops & OP_LATENCY_ON) != 0);
+  }
+  if (ops & OP_LATENCY_RESET) {
+    latency_reset();
+  }
+  if (ops & OP_RESTART) {
+    console_flush();
+    delay(150);
+#ifndef TARGET_NATIVE
+    esp_restart();
 #endif
+  }
 
-void notFound(AsyncWebServerRequest* request) {
-  request->send(404, "text/plain", "Not found");
+  // the web server only reads the debugger state from here
+  static uint32_t debugShown = 0;
+  if (debug_changes() != debugShown) {
+    debugShown = debug_changes();
+    String json = debugInfo(emu);
+    std::lock_guard<std::mutex> guard(webLock);
+    debugState = json;
+  }
 }
 
-char* instr(octo_emulator* emu, uint16_t addr) {
-  uint8_t hi = emu->ram[addr], lo = emu->ram[addr+1], op = hi >> 4;  
-  uint16_t wd = hi;
-  wd <<= 8; wd |= lo;
-  static char buf[13]; 
-  switch (op) {
-    case 0x0:
-      switch (wd) {
-        case 0x00E0:
-          return "cls";
-        case 0x00EE:
-          return "ret";
-        case 0x00FF:
-          return "hires";
-        case 0x00FE:
-          return "lores";
-        case 0x00FD:
-          return "exit";
-        case 0x00FB:
-          return "scr";
-        case 0x00FC:
-          return "scl";
-        default:
-          if (lo & 0xF0 == 0xC0) {
-            snprintf(buf, 8, "scd d %X", lo & 0x0F);
-          }
-          else {
-            buf[0] = '\0';
-          }
-          return buf;
-      }
-      break;
-    case 0x1:
-      snprintf(buf, 7, "jp %03X", wd & 0xFFF);
-      return buf;
-    case 0x2:
-      snprintf(buf, 9, "call %03X", wd & 0xFFF);
-      return buf;
-    case 0x3:
-      snprintf(buf, 9, "se v%X,%02X", hi & 0xF, lo);
-      return buf;
-    case 0x4:
-      snprintf(buf, 10, "sne v%X,%02X", hi & 0xF, lo);
-      return buf;
-    case 0x5:
-      snprintf(buf, 9, "se v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-      return buf;
-    case 0x6:
-      snprintf(buf, 9, "ld v%X,%02X", hi & 0xF, lo);
-      return buf;
-    case 0x7:
-      snprintf(buf, 10, "add v%X,%02X", hi & 0xF, lo);
-      return buf;
-    case 0x8:
-      switch (lo & 0xF) {
-        case 0x0:
-          snprintf(buf, 9, "ld v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x1:
-          snprintf(buf, 9, "or v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x2:
-          snprintf(buf, 10, "and v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x3:
-          snprintf(buf, 10, "xor v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x4:
-          snprintf(buf, 10, "add v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x5:
-          snprintf(buf, 10, "sub v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x6:
-          snprintf(buf, 10, "shr v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0x7:
-          snprintf(buf, 11, "subn v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        case 0xE:
-          snprintf(buf, 10, "shl v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-          return buf;
-        default: 
-          buf[0] = '\0';
-          return buf;
-      }
-    case 0x9:
-      snprintf(buf, 10, "sne v%X,v%X", hi & 0xF, lo & 0xF0 >> 4);
-      return buf;
-    case 0xa:
-      snprintf(buf, 9, "ld i %03X", wd & 0xFFF);
-      return buf;
-    case 0xb:
-      snprintf(buf, 9, "jp v0,%03X", wd & 0xFFF);
-      return buf;
-    case 0xc:
-      snprintf(buf, 9, "rnd v%X,%02X", hi & 0xF, lo);
-      return buf;
-    case 0xd:
-      snprintf(buf, 12, "drw v%X,v%X,%X", hi & 0xF, lo >> 4, lo & 0xF);
-      return buf;
-    case 0xe:
-      switch (lo) {
-        case 0x9E:
-          snprintf(buf, 7, "skp v%X", hi & 0xF);
-          return buf;
-        case 0xA1:
-          snprintf(buf, 8, "sknp v%X", hi & 0xF);
-          return buf;
-        default: 
-          buf[0] = '\0';
-          return buf;
-      }
-    case 0xf:
-      switch (lo) {
-        case 0x07:
-          snprintf(buf, 9, "ld v%X,dt", hi & 0xF);
-          return buf;
-        case 0x0A:
-          snprintf(buf, 8, "ld v%X,k", hi & 0xF);
-          return buf;
-        case 0x15:
-          snprintf(buf, 9, "ld dt,v%X", hi & 0xF);
-          return buf;
-        case 0x18:
-          snprintf(buf, 9, "ld st,v%X", hi & 0xF);
-          return buf;
-        case 0x1E:
-          snprintf(buf, 9, "add i,v%X", hi & 0xF);
-          return buf;
-        case 0x29:
-          snprintf(buf, 8, "ld f,v%X", hi & 0xF);
-          return buf;
-        case 0x33:
-          snprintf(buf, 8, "ld b,v%X", hi & 0xF);
-          return buf;
-        case 0x55:
-          snprintf(buf, 10, "ld [i],v%X", hi & 0xF);
-          return buf;
-        case 0x65:
-          snprintf(buf, 10, "ld v%X,[i]", hi & 0xF);
-          return buf;
-        default: 
-          buf[0] = '\0';
-          return buf;
-      }
-    default: 
-      buf[0] = '\0';
-      return buf;
+// Opens the catalog when it's first needed and selects the running program
+void needPrgInfo(void) {
+  static bool opened = false;
+  if (opened || !catalog_open()) {
+    return;
   }
+  opened = true;
+  selectLoaded();
 }
 
-String filesInfo(const String& var) {
-  if (var == "FILELIST") {
-    String html;
-    File root = SPIFFS.open("/");
-    File file = root.openNextFile();
+void loadCurrPrg(octo_emulator* emu) {
+  needPrgInfo();
+  char path[CATALOG_NAME + 1] = "/";
+  if (!catalog_name(currPrg, path + 1)) {
+    console_printf("Invalid program index %d\r\n", currPrg);
+    return;
+  }
+  loadPath(path, emu);
+}
 
-    while (file) {
-      String name = file.name();
+// Selects the first program of the next initial, or the first one
+void nextInitial(octo_emulator* emu) {
+  needPrgInfo();
+  char name[CATALOG_NAME];
+  if (!catalog_name(currPrg, name)) {
+    return;
+  }
+  char next[2] = { (char)(tolower((unsigned char)name[0]) + 1), '\0' };
+  int i = catalog_find(next);
+  currPrg = i < catalog_count() ? i : 0;
+  showCurrPrg(emu);
+}
 
-      if (name.endsWith(".ec8")) {
-        html += "<p>";
-        html += name;
-        html += " <a href=\"/delete?file=" + name + "\">[delete]</a>";
-        html += "</p>";
-      }
-      file = root.openNextFile();
+void notFound(AsyncWebServerRequest* request) {
+  request->send(404, "text/plain", "Not found");
+}
+
+// One page of the catalog from entry first, with links to the others
+String filesInfo(const String& var, int first) {
+  if (var == "FILELIST") {
+    String html;
+    char name[CATALOG_NAME];
+    for (int i = first; i < first + FILES_PAGE && catalog_name(i, name); i++) {
+      html += "<p>";
+      html += name;
+      html += " <a href=\"/delete?file=";
+      html += name;
+      html += "\">[delete]</a></p>";
     }
 
     if (html.isEmpty()) {
-      html = "<p><i>No .ec8 files</i></p>";
+      html = "<p><i>No .ec8 or .ch8 files</i></p>";
     }
-
+    return html;
+  }
+  if (var == "PAGES") {
+    int count = catalog_count();
+    String html = "<p>";
+    if (first > 0) {
+      html += "<a href=\"/files?from=" + String(first > FILES_PAGE ? first - FILES_PAGE : 0) + "\">&larr;</a> ";
+    }
+    html += String(count ? first + 1 : 0) + "-" + String(first + FILES_PAGE < count ? first + FILES_PAGE : count);
+    html += " of " + String(count);
+    if (first + FILES_PAGE < count) {
+      html += " <a href=\"/files?from=" + String(first + FILES_PAGE) + "\">&rarr;</a>";
+    }
+    html += " <a href=\"/files?cmd=rescan\">[rescan]</a></p>";
     return html;
   }
   return String();
 }
 
+// Disassembly with hit counts for /profile?format=asm, *line keeps the position
+size_t profileAsm(const profile_copy* copy, uint8_t* buf, size_t size, uint32_t* line) {
+  size_t len = 0;
+  int lines = disasm_cache_lines();
+
+  // the cache locks each call, a load in between ends the listing
+  while ((int)*line < lines && size - len >= 11 + DISASM_LINE_MAX) {
+    char text[DISASM_LINE_MAX];
+    if (!disasm_cache_range(emu->ram, *line, 1, text, sizeof(text))) {
+      *line = lines;
+      break;
+    }
+    uint32_t hits = profile_copy_hits(copy, disasm_cache_addr(*line));
+    len += snprintf((char*)buf + len, size - len, "%10u %s", (unsigned)hits, text);
+    (*line)++;
+  }
+  // 0 would end the response, a short buffer is asked for again
+  return len || (int)*line >= lines ? len : RESPONSE_TRY_AGAIN;
+}
+
+uint16_t hexParam(AsyncWebServerRequest* request, const char* name) {
+  if (!request->hasParam(name)) {
+    return 0;
+  }
+  return strtol(request->getParam(name)->value().c_str(), NULL, 16);
+}
+
 String webInfo(const String& var) {
   if (var == "NAME") {
-    char* p = strrchr(prg[currPrg], '.');
-    *p = '\0';
-    String name(prg[currPrg]);
-    *p = '.';
-    return name;
+    char name[SNAPSHOT_PATH_MAX];
+    prgName(name, sizeof(name));
+    return String(name);
   }
   else
   if (var == "CODE") {
-    char line[26];
-    String buffer;
-    uint16_t addr;
-    for (addr = 0x200; addr < ch8Size + 0x200; addr += 2) {
-      snprintf(line, 24, "%04X: %02X%02X %s\n", addr,
-        emu->ram[addr], emu->ram[addr+1],
-        instr(emu, addr));
-      buffer += line;
+    // one line per word is an upper bound (long instructions take two)
+    size_t size = (ch8Size / 2 + 1) * DISASM_LINE_MAX;
+    char* code = (char*)malloc(size);
+    if (!code) {
+      return String();
+    }
+    int lines = disasm_cache_lines();
+    if (lines) {
+      disasm_cache_range(emu->ram, 0, lines, code, size);
     }
+    else {
+      disasm_range(emu->ram, 0x200, ch8Size + 0x200, code, size);
+    }
+    String buffer(code);
+    free(code);
     return buffer;
   }
   return String();
 }
 
-void setup(void)
-{
-  lcd.init();
-  lcd.setRotation(2);
-  lcd.setColorDepth(16);
-  lcd.fillScreen(0xFF000000u);
-  lcd.setFont(&fonts::FreeMonoBold12pt7b);
-
-  Serial.begin(115200);
-
-  while (!SPIFFS.begin(true)) {
-    console_printf("SPIFFS.begin failed!\r\n");
-    lcd.drawString("SPIFFS not initialized!", 0, 0, &fonts::FreeMonoBold12pt7b);
-    delay(500);
-  }
-  lcd.fillScreen(0xFF000000u);
-
-  loadPrgInfo();
-
-  emu = (octo_emulator*)calloc(1, sizeof(octo_emulator));
-
-  console_printf("Connecting...\r\n");
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
-  if (WiFi.waitForConnectResult() != WL_CONNECTED) {
-    console_printf("WiFi failed!\r\n");
-    return;
-  }
+// Registers the web interface and starts serving it
+void startServer(void) {
   server = new AsyncWebServer(80);
-  console_printf("IP Address: %s\r\n", WiFi.localIP().toString().c_str());
+  // any request may change what's shown, wake the loop up for it
+  server->addMiddleware([](AsyncWebServerRequest *request, ArMiddlewareNext next) {
+    idle_wake();
+    next();
+  });
   server->on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
     request->send(SPIFFS, "/index.html", "text/html", false, webInfo);
   });
 
+  // /files?from=N pages, ?prefix=s finds the page with s, ?cmd=rescan
+  // rebuilds the catalog after files were copied to the card
+  // The catalog locks itself; loop() selects in it and does the slow
+  // changes, rescans and updates after uploads and deletes
   server->on("/files", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(SPIFFS, "/files.html", "text/html", false, filesInfo);
+    if (request->hasParam("cmd") && request->getParam("cmd")->value() == "rescan") {
+      pendingOps |= OP_CATALOG_REBUILD;
+      request->send(202, "text/plain", "rescanning");
+      return;
+    }
+    catalog_open();
+    int first = 0;
+    if (request->hasParam("prefix")) {
+      first = catalog_find(request->getParam("prefix")->value().c_str());
+      first = first < catalog_count() ? first : catalog_count() - 1;
+    }
+    else
+    if (request->hasParam("from")) {
+      first = request->getParam("from")->value().toInt();
+    }
+    first = first > 0 ? first : 0;
+    request->send(SPIFFS, "/files.html", "text/html", false,
+      [first](const String& var) { return filesInfo(var, first); });
   });
 
-  #include "esp_system.h"
-
   server->on(
     "/upload",
     HTTP_POST,
@@ -636,7 +979,7 @@ void setup(void)
 
       // início do upload
       if (index == 0) {
-        valid = filename.endsWith(".ec8");
+        valid = filename.endsWith(".ec8") || filename.endsWith(".ch8");
 
         // lê checkbox
         doReboot = request->hasParam("reboot", true);
@@ -656,13 +999,14 @@ void setup(void)
 
       if (final) {
         if (uploadFile) uploadFile.close();
+        queueCatalog(CMD_CATALOG_ADD, filename.c_str());
 
         console_printf("Upload complete (%s)\r\n",
                       doReboot ? "reboot" : "no reboot");
 
+        // once loop() has the file in the catalog
         if (doReboot) {
-          delay(150);
-          esp_restart();
+          pendingOps |= OP_RESTART;
         }
       }
     }
@@ -675,29 +1019,338 @@ void setup(void)
     }
 
     String filename = request->getParam("file")->value();
+    if (!filename.startsWith("/")) {
+      filename = "/" + filename;
+    }
 
-    if (filename.endsWith(".ec8") && SPIFFS.exists(filename)) {
+    if ((filename.endsWith(".ec8") || filename.endsWith(".ch8")) && SPIFFS.exists(filename)) {
       SPIFFS.remove(filename);
+      queueCatalog(CMD_CATALOG_REMOVE, filename.c_str());
     }
 
     request->redirect("/files");
   });
 
+  // /debug?cmd=break&addr=2A4, watch&from=300&to=30F, clear, unwatch,
+  // pause, step, over, continue; always answers with the debugger state.
+  // Commands run in loop(), the state is the one before them.
+  server->on("/debug", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String("state");
+    bool queued = true;
+
+    if (cmd == "break") {
+      queued = queueCommand(CMD_BREAK, hexParam(request, "addr"), 0);
+    }
+    else
+    if (cmd == "clear") {
+      queued = queueCommand(CMD_CLEAR_BREAKS, 0, 0);
+    }
+    else
+    if (cmd == "watch") {
+      queued = queueCommand(CMD_WATCH, hexParam(request, "from"), hexParam(request, "to"));
+    }
+    else
+    if (cmd == "unwatch") {
+      queued = queueCommand(CMD_CLEAR_WATCHES, 0, 0);
+    }
+    else
+    if (cmd == "pause") {
+      queued = queueCommand(CMD_PAUSE, 0, 0);
+    }
+    else
+    if (cmd == "step") {
+      queued = queueCommand(CMD_STEP, 0, 0);
+    }
+    else
+    if (cmd == "over") {
+      queued = queueCommand(CMD_STEP_OVER, 0, 0);
+    }
+    else
+    if (cmd == "continue") {
+      queued = queueCommand(CMD_CONTINUE, 0, 0);
+    }
+    if (!queued) {
+      request->send(503, "text/plain", "busy");
+      return;
+    }
+    String json;
+    {
+      std::lock_guard<std::mutex> guard(webLock);
+      json = debugState;
+    }
+    request->send(200, "application/json", json);
+  });
+
+  // /profile?cmd=start|stop|clear|save, then the counts as format=json
+  // (default), bin (as profile_save() writes it) or asm (annotated code).
+  // The counts are the ones before the command, it's done by the next frame.
+  server->on("/profile", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String();
+    String format = request->hasParam("format") ? request->getParam("format")->value() : String("json");
+
+    if (cmd == "start") {
+      pendingOps |= OP_PROFILE_START;
+    }
+    else
+    if (cmd == "stop") {
+      pendingOps |= OP_PROFILE_STOP;
+    }
+    else
+    if (cmd == "clear") {
+      pendingOps |= OP_PROFILE_CLEAR;
+    }
+    else
+    if (cmd == "save") {
+      pendingOps |= OP_PROFILE_SAVE;
+    }
+
+    // the response owns a copy, the counts may be freed while it's sent
+    std::shared_ptr<profile_copy> copy(profile_snapshot(), free);
+    if (!copy) {
+      request->send(404, "text/plain", "No profile");
+      return;
+    }
+    std::shared_ptr<uint32_t> cursor(new uint32_t(0));
+    if (format == "bin") {
+      request->send(request->beginChunkedResponse("application/octet-stream",
+        [copy, cursor](uint8_t* buf, size_t size, size_t index) -> size_t {
+          return profile_bin(copy.get(), buf, size, cursor.get());
+        }));
+    }
+    else
+    if (format == "asm") {
+      request->send(request->beginChunkedResponse("text/plain",
+        [copy, cursor](uint8_t* buf, size_t size, size_t index) -> size_t {
+          return profileAsm(copy.get(), buf, size, cursor.get());
+        }));
+    }
+    else {
+      request->send(request->beginChunkedResponse("application/json",
+        [copy, cursor](uint8_t* buf, size_t size, size_t index) -> size_t {
+          return profile_json(copy.get(), (char*)buf, size, cursor.get());
+        }));
+    }
+  });
+
+  // /record?cmd=start restarts the program and records the input,
+  // /record?cmd=stop saves it to SESSION_PATH; both by the next frame
+  server->on("/record", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String();
+
+    if (cmd == "start") {
+      pendingOps |= OP_RECORD_START;
+    }
+    else
+    if (cmd == "stop") {
+      pendingOps |= OP_RECORD_STOP;
+    }
+    request->send(200, "text/plain", cmd == "start" || cmd == "stop" ? "queued" :
+      replay_state() == REPLAY_RECORD ? "recording" : "stopped");
+  });
+
+  // /replay?cmd=start plays SESSION_PATH back from the next frame,
+  // /replay reports the last playback
+  server->on("/replay", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("cmd") && request->getParam("cmd")->value() == "start") {
+      pendingOps |= OP_REPLAY_START;
+    }
+    char report[160 + REPLAY_PATH_MAX];
+    replay_report(emu, report, sizeof(report));
+    request->send(200, "application/json", report);
+  });
+
+  // /turbo?cmd=on|off|toggle, switched by the next frame; answers with the
+  // state asked for and the frames per tick
+  server->on("/turbo", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String();
+
+    bool on = isTurbo;
+    if (cmd == "on" || cmd == "off" || cmd == "toggle") {
+      on = cmd == "toggle" ? !isTurbo : cmd == "on";
+      pendingOps |= cmd == "toggle" ? OP_TURBO_TOGGLE : cmd == "on" ? OP_TURBO_ON : OP_TURBO_OFF;
+    }
+    char state[48];
+    snprintf(state, sizeof(state), "{\"turbo\":%s,\"frames\":%d}",
+      on ? "true" : "false", on ? turboFrames : 1);
+    request->send(200, "application/json", state);
+  });
+
+  // /latency?cmd=on|off|reset, answers with the histograms of the delays
+  // from a key press to its read and to the next frame on the display
+  server->on("/latency", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String();
+
+    if (cmd == "on" || cmd == "off") {
+      pendingOps |= cmd == "on" ? OP_LATENCY_ON : OP_LATENCY_OFF;
+    }
+    else
+    if (cmd == "reset") {
+      pendingOps |= OP_LATENCY_RESET;
+    }
+    char stats[384];
+    latency_stats(stats, sizeof(stats));
+    request->send(200, "application/json", stats);
+  });
+
+  // /rewind reports the history kept and the time capturing it takes
+  server->on("/rewind", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char stats[160];
+    rewind_stats(stats, sizeof(stats));
+    request->send(200, "application/json", stats);
+  });
+
+  // /snapshot?cmd=save|load|drop on RESUME_PATH, the state resumed at boot,
+  // done by the next frame
+  server->on("/snapshot", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String cmd = request->hasParam("cmd") ? request->getParam("cmd")->value() : String();
+    uint32_t op = cmd == "save" ? OP_SNAPSHOT_SAVE : cmd == "load" ? OP_SNAPSHOT_LOAD :
+      cmd == "drop" ? OP_SNAPSHOT_DROP : 0;
+
+    if (!op) {
+      request->send(400, "text/plain", "cmd=save|load|drop");
+      return;
+    }
+    pendingOps |= op;
+    request->send(202, "text/plain", "queued");
+  });
+
   server->onNotFound(notFound);
   server->begin();
+}
+
+const unsigned long WIFI_TIMEOUT = 10000;       // ms for a connection attempt
+const unsigned long WIFI_BACKOFF = 300000;      // ms between attempts at most
+
+volatile unsigned long retryAt;     // millis() of the next connection attempt
 
-  loadCurrPrg(emu);
+// Connects in the background, retrying with growing pauses, then serves
+void network(void* param) {
+  unsigned long pause = 1000;
+  for (;;) {
+    console_printf("Connecting...\r\n");
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(ssid, password);
+    if (WiFi.waitForConnectResult(WIFI_TIMEOUT) == WL_CONNECTED) {
+      break;
+    }
+    console_printf("WiFi failed, retrying in %lu s\r\n", pause / 1000);
+    // the radio is off in between, so idle may light-sleep until the retry
+    retryAt = millis() + pause;
+    WiFi.mode(WIFI_OFF);
+    // a sleeping loop picks up the new deadline
+    idle_wake();
+    delay(pause);
+    pause = pause * 2 < WIFI_BACKOFF ? pause * 2 : WIFI_BACKOFF;
+  }
+  console_printf("IP Address: %s\r\n", WiFi.localIP().toString().c_str());
+  startServer();
+#ifndef TARGET_NATIVE
+  vTaskDelete(NULL);
+#endif
+}
+
+// ms light sleep may last: it would drop the connection, so only while
+// the radio is off, and the next attempt mustn't wait for a touch
+long lightSleepMs(void) {
+  long left = (long)(retryAt - millis());
+  return WiFi.getMode() == WIFI_OFF && left > 0 ? left : 0;
+}
+
+void setup(void)
+{
+  lcd.init();
+  lcd.setRotation(2);
+  lcd.setColorDepth(16);
+  lcd.fillScreen(0xFF000000u);
+  lcd.setFont(&fonts::FreeMonoBold12pt7b);
+
+  Serial.begin(115200);
+  console_init();
+  if (!text_init(&lcd)) {
+    console_printf("No memory for text\r\n");
+  }
+
+  while (!SPIFFS.begin(true)) {
+    console_printf("SPIFFS.begin failed!\r\n");
+    lcd.drawString("SPIFFS not initialized!", 0, 0, &fonts::FreeMonoBold12pt7b);
+    delay(500);
+  }
+  lcd.fillScreen(0xFF000000u);
+  if (!thumbs_open(THUMBS_PATH)) {
+    console_printf("No thumbnails in %s\r\n", THUMBS_PATH);
+  }
+
+#if defined(TARGET_NATIVE)
+  // sdl_main.cpp notifies mouse presses
+  touch_init(TOUCH_NOTIFIED);
+  idle_init(-1);
+#elif defined(XPT2046_TOUCH_CONFIG_INT_GPIO_NUM)
+  touch_init(XPT2046_TOUCH_CONFIG_INT_GPIO_NUM);
+  idle_init(XPT2046_TOUCH_CONFIG_INT_GPIO_NUM);
+#else
+  touch_init(-1);
+  idle_init(-1);
+#endif
+
+  emu = (octo_emulator*)calloc(1, sizeof(octo_emulator));
+  if (!audio_init()) {
+    console_printf("No audio\r\n");
+  }
+
+  // the catalog is only read once a program gets selected
+  if (!resumeSnapshot(emu)) {
+    loadCurrPrg(emu);
+  }
+
+#ifdef TARGET_NATIVE
+  // profiles are written next to the ROM when another one is loaded
+  if (getenv("ESPOCTO_PROFILE")) {
+    profile_start(0x200, 0x200 + ch8Size);
+  }
+  // ESPOCTO_RECORD=file records until exit, ESPOCTO_REPLAY=file plays it back
+  if (getenv("ESPOCTO_REPLAY")) {
+    startReplay(getenv("ESPOCTO_REPLAY"), emu);
+  }
+  else
+  if (getenv("ESPOCTO_RECORD")) {
+    startRecording(emu);
+    atexit([]() { replay_save(getenv("ESPOCTO_RECORD")); });
+  }
+  isUncapped = getenv("ESPOCTO_UNCAPPED") != NULL;
+  // ESPOCTO_LATENCY probes touches or the replayed input, reported at exit
+  if (getenv("ESPOCTO_LATENCY")) {
+    latency_enable(true);
+    // console_init() registered its flush first, it runs after this
+    atexit(latency_report);
+  }
+#endif
   drawButtons();
 
   page = PAGE_MAIN;
+  console_printf("Ready after %lu ms\r\n", millis());
+
+  // the game runs while WiFi connects
+#ifdef TARGET_NATIVE
+  std::thread(network, (void*)NULL).detach();
+#else
+  xTaskCreatePinnedToCore(network, "network", 6144, NULL, 1, NULL, 0);
+#endif
 }
 
-void ui_run(octo_emulator* emu) {
+// Returns true if the display was drawn
+bool ui_run(octo_emulator* emu) {
   // drop repaints if the display hasn't changed
+#ifdef SCREEN_PACKED
+  int dirty = screen_changed(emu);
+#else
   int dirty = memcmp(emu->px, emu->ppx, sizeof(emu->px)) != 0;
+#endif
 
-  if (!dirty) return;
+  if ((!dirty && !redraw) || (isBrowsing && !isMonitor)) return false;
+#ifndef SCREEN_PACKED
   memcpy(emu->ppx,emu->px,sizeof(emu->ppx));
+#endif
+  redraw = false;
 
   // render chip8 display
   int w = emu->hires ? 128 : 64, h = emu->hires ? 64 : 32;
@@ -707,17 +1360,20 @@ void ui_run(octo_emulator* emu) {
   if (emu->hires != lastRes) {
     lastRes = emu->hires;
     lcd.fillCircle(10, 32, 4, emu->hires ? 0xFFFF6600u : 0xFF996600u);
-    console_printf("%sres rot=%d w=%d h=%d scale=%f\r\n", emu->hires ? "hi" : "lo", emu->options.rotation, w, h, scale);
+    console_debug("%sres rot=%d w=%d h=%d scale=%f\r\n", emu->hires ? "hi" : "lo", emu->options.rotation, w, h, scale);
   }
 
   sprite.createSprite(w, h);
   sprite.setPivot(w / 2, 0);
   sprite.setColorDepth(4);
-  sprite.setPaletteColor(0, 0xFF996600u);
-  sprite.setPaletteColor(1, 0xFFFFCC00u);
-  sprite.setPaletteColor(2, 0xFFFF6600u);
-  sprite.setPaletteColor(3, 0xFF662200u);
+  // background, fill 1, fill 2, blend
+  for (int n = 0; n < 4; n++) {
+    sprite.setPaletteColor(n, (uint32_t)emu->options.colors[n]);
+  }
 
+#ifdef SCREEN_PACKED
+  screen_render(emu, (uint8_t*)sprite.getBuffer());
+#else
   for(int y=0; y<h; y++) {
     for(int x=0; x<w; x++) {
       int c = emu->px[x + (y*w)];
@@ -726,8 +1382,16 @@ void ui_run(octo_emulator* emu) {
     }
     //console_printf("\n");
   }
-  sprite.pushRotateZoom(lcd.width() / 2, 74, 0, scale * 1.3 , scale);
+#endif
+  if (isLiveMonitor) {
+    // 96x48 viewport left of the registers
+    sprite.pushRotateZoom(52, 46, 0, scale / 2, scale / 2);
+  }
+  else {
+    sprite.pushRotateZoom(lcd.width() / 2, 74, 0, scale * 1.3 , scale);
+  }
   sprite.deleteSprite();
+  return true;
 }
 
 void emu_step(octo_emulator* emu) {
@@ -739,42 +1403,219 @@ void emu_step(octo_emulator* emu) {
     }
     return;
   }
-  for (int z=0; z<emu->options.tickrate && !emu->halt; z++) {
-    if (emu->options.q_vblank && (emu->ram[emu->pc]&0xF0) == 0xD0) {
-        z=emu->options.tickrate;
+  if (debug_paused()) {
+    return;
+  }
+
+  // only frames that run count for the input log, once each
+  if (!debug_midframe()) {
+    // replayed presses are probed from the start of the frame applying them
+    int held[16];
+    memcpy(held, emu->keys, sizeof(held));
+    replay_input(emu);
+    if (replay_state() == REPLAY_PLAY) {
+      for (int k = 0; k < 16; k++) {
+        if (emu->keys[k] && !held[k]) {
+          latency_press(k, micros());
+        }
+      }
+    }
+  }
+
+  if (debug_armed()) {
+    // the timers only count whole frames
+    if (debug_run(emu, emu->options.tickrate)) {
+      return;
+    }
+  }
+  else
+  if (profile_enabled()) {
+    profile_run(emu, emu->options.tickrate);
+  }
+  else
+  if (aot_active()) {
+    aot_run(emu, emu->options.tickrate);
+  }
+  else {
+    bool probing = latency_reading();
+    for (int z=0; z<emu->options.tickrate && !emu->halt; z++) {
+      if (emu->options.q_vblank && (emu->ram[emu->pc]&0xF0) == 0xD0) {
+          z=emu->options.tickrate;
+      }
+      if (probing && latency_instruction(emu, micros())) {
+        probing = false;
+      }
+      //console_printf("pc=%0x", emu->pc);
+      screen_instruction(emu);
     }
-    //console_printf("pc=%0x", emu->pc);
-    octo_emulator_instruction(emu);
   }
   if (emu->dt>0) emu->dt--;
   if (emu->st>0) emu->st--, emu->had_sound=1;
+  profile_frame();
+
+  if (rewind_enabled()) {
+    unsigned long start = micros();
+    rewind_capture(emu);
+    rewind_timing(micros() - start);
+  }
+}
+
+const unsigned long MONITOR_REFRESH = 100;  // ms between register updates of the live monitor
+
+// The paused monitor lists 5 words, the live one 3 below the registers.
+// The second row is the one being edited.
+int monitorRows(void) {
+  return isLiveMonitor ? 3 : 5;
+}
+
+int monitorRowY(int i) {
+  return isLiveMonitor ? 78 + i*17 : 24 + i*20;
+}
+
+void showMonitorRow(octo_emulator* emu, int i) {
+  uint16_t addr = monitorAddr - 2 + 2*i;
+  int y = monitorRowY(i);
+
+  text_begin(240, 16);
+  if (debug_is_break(addr)) {
+    text_put(TEXT_LARGE, 4, 0, "*");
+  }
+
+  char buf[12 + DISASM_MAX];
+  char* p = disasm_hex(buf, addr, 4);
+  memcpy(p, ":       ", 8);
+  disasm_cached_instr(emu->ram, addr, p + 8);
+  text_put(TEXT_LARGE, 20, 0, buf);
+
+  // the word, the nibble being edited inverted
+  disasm_hex(buf, (emu->ram[addr] << 8) | emu->ram[addr+1], 4);
+  char c[2];
+  c[1] = '\0';
+  for (int n = 0; n < 4; n++) {
+    c[0] = buf[n];
+    text_put(TEXT_LARGE, 20 + 48 + n*8, 0, c, i == 1 && n == monitorNibble);
+  }
+  text_push(0, y, 0xFFFFCC00u, 0xFF996600u);
+}
+
+void showMonitorRows(octo_emulator* emu) {
+  for (int i = 0; i < monitorRows(); i++) {
+    showMonitorRow(emu, i);
+  }
+}
+
+// Register cells of the live monitor, -1 forces a repaint
+enum {
+  REG_PC, REG_I, REG_DT, REG_ST, REG_SP, REG_V0, REG_OP = REG_V0 + 16, REG_COUNT
+};
+static int32_t regShown[REG_COUNT];
+
+void showRegister(int reg, int32_t value) {
+  if (regShown[reg] == value) {
+    return;
+  }
+  regShown[reg] = value;
+
+  // 6x8 font, right of the viewport
+  char buf[4 + DISASM_MAX];
+  int x = 104, y;
+  switch (reg) {
+    case REG_PC:
+      x += 3*6, y = 21;
+      *disasm_hex(buf, value, 4) = '\0';
+      break;
+    case REG_I:
+      x += 10*6, y = 21;
+      *disasm_hex(buf, value, 4) = '\0';
+      break;
+    case REG_DT:
+    case REG_ST:
+    case REG_SP:
+      x += (3 + (reg - REG_DT) * 6) * 6, y = 37;
+      *disasm_hex(buf, value, 2) = '\0';
+      break;
+    default:
+      x += (3 + ((reg - REG_V0) & 3) * 3) * 6, y = 45 + ((reg - REG_V0) >> 2) * 8;
+      *disasm_hex(buf, value, 2) = '\0';
+      break;
+  }
+  text_begin(strlen(buf) * 6, 8);
+  text_put(TEXT_SMALL, 0, 0, buf);
+  text_push(x, y, 0xFFFFCC00u, 0xFF996600u);
+}
+
+void showRegisters(octo_emulator* emu) {
+  showRegister(REG_PC, emu->pc);
+  showRegister(REG_I, emu->i);
+  showRegister(REG_DT, emu->dt);
+  showRegister(REG_ST, emu->st);
+  showRegister(REG_SP, emu->rp);
+  for (int n = 0; n < 16; n++) {
+    showRegister(REG_V0 + n, emu->v[n]);
+  }
+
+  // instruction at pc, repainted when pc or the word there changes
+  uint16_t pc = emu->pc;
+  int32_t op = (int32_t)pc << 16 | (emu->ram[pc] << 8) | emu->ram[(uint16_t)(pc + 1)];
+  if (regShown[REG_OP] != op) {
+    regShown[REG_OP] = op;
+    char buf[2 + DISASM_MAX];
+    buf[0] = '>';
+    buf[1] = ' ';
+    disasm_cached_instr(emu->ram, pc, buf + 2);
+    text_begin(136, 8);
+    text_put(TEXT_SMALL, 0, 0, buf);
+    text_push(104, 29, 0xFFFFCC00u, 0xFF996600u);
+  }
 }
 
 void showMonitor(octo_emulator* emu) {
   lcd.fillRect(0, 20, 240, 108, 0xFF996600u);
 
-  uint16_t addr = monitorAddr - 2;
+  if (isLiveMonitor) {
+    text_begin(136, 8);
+    text_put(TEXT_SMALL, 0, 0, "PC");
+    text_put(TEXT_SMALL, 8*6, 0, "I");
+    text_push(104, 21, 0xFFFFCC00u, 0xFF996600u);
+    text_begin(136, 8);
+    text_put(TEXT_SMALL, 0, 0, "DT");
+    text_put(TEXT_SMALL, 6*6, 0, "ST");
+    text_put(TEXT_SMALL, 12*6, 0, "SP");
+    text_push(104, 37, 0xFFFFCC00u, 0xFF996600u);
+    for (int n = 0; n < 16; n += 4) {
+      char label[3] = { 'V', "048C"[n / 4], '\0' };
+      text_begin(136, 8);
+      text_put(TEXT_SMALL, 0, 0, label);
+      text_push(104, 45 + n*2, 0xFFFFCC00u, 0xFF996600u);
+    }
+    for (int reg = 0; reg < REG_COUNT; reg++) {
+      regShown[reg] = -1;
+    }
+    showRegisters(emu);
+    redraw = true;
+  }
+  showMonitorRows(emu);
+}
+
+// The debugger paused the program: show where in the live monitor
+void showDebugStop(octo_emulator* emu) {
+  console_printf("%s at %04X\r\n", debug_reason_name(debug_why()), emu->pc);
 
-  char buf[25];
-  for (int i = 0; i < 5; i++) {
-    snprintf(buf, 24, "%04X:       %s", addr, instr(emu, addr));
-    lcd.drawString(buf, 20, 24 + i*20, &fonts::AsciiFont8x16);
+  isMonitor = true;
+  isLiveMonitor = true;
+  monitorAddr = emu->pc;
+  monitorNibble = 0;
+  showMonitor(emu);
+}
 
-    snprintf(buf, 5, "%02X%02X", emu->ram[addr], emu->ram[addr+1]);
-    char c[2];
-    c[1] = '\0';
-    for (int n = 0; n < 4; n++) {
-      if (i == 1 && n == monitorNibble) {
-        lcd.setTextColor(0xFF996600u, 0xFFFFCC00u);
-      }
-      else {
-        lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
-      }
-      c[0] = buf[n];
-      lcd.drawString(c, 20 + 48 + n*8, 24 + i*20, &fonts::AsciiFont8x16);
-      lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
-    }
-    addr += 2;
+// Called every tick while the live monitor is shown
+void updateLiveMonitor(octo_emulator* emu) {
+  static unsigned long lastRefresh = 0;
+  unsigned long now = millis();
+
+  if (now - lastRefresh >= MONITOR_REFRESH) {
+    lastRefresh = now;
+    showRegisters(emu);
   }
 }
 
@@ -846,110 +1687,197 @@ void showSavePage(void) {
 #endif
 
 void handleTouchMain(octo_emulator* emu, int touchX, int touchY) {
-  for (int i = 0; i < 20; i++) {
-    if (btn[i].contains(touchX, touchY)) {
-      btn[i].press(true);
-      btn[i].drawButton(true);
+  int i = keyAt(touchX, touchY);
+  if (i < 0) {
+    return;
+  }
+  // only a new press is drawn, holding a key costs no display traffic
+  bool justPressed = !((pressedKeys >> i) & 1);
+  if (justPressed) {
+    pressedKeys |= 1u << i;
+    drawKey(i, true);
+
+    lcd.setTextColor(0xFF996600u, 0xFFFFCC00u);
+    lcd.drawString(lbl[i], 228, 0, &fonts::FreeMonoBold9pt7b);
+    lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
+  }
 
-      lcd.setTextColor(0xFF996600u, 0xFFFFCC00u);
-      lcd.drawString(lbl[i], 228, 0, &fonts::FreeMonoBold9pt7b);
-      lcd.setTextColor(0xFFFFCC00u, 0xFF996600u);
+  std::int8_t b = hexButton(i);
 
-      std::int8_t b = hexButton(i);
-  
-      if (btn[i].justPressed()) {
-        if (isMonitor) {
-          if (b == KEY_LEFT) {
-            if (monitorAddr >= 0x202) {
-              monitorAddr -= 2;
-              monitorNibble = 0;
-              showMonitor(emu);
-            }
-          }
-          else
-          if (b == KEY_RIGHT) {
-            if (monitorAddr < 4 * 1024 - 2) {
-              monitorAddr += 2;
-              monitorNibble = 0;
-              showMonitor(emu);
-            }
-          }
-          else
-          if (b == KEY_GO) {
-            console_printf("Saving...\r\n");
-          }
-          else
-          if (b == KEY_MONITOR) {
-            isMonitor = false;
-            lcd.fillRect(0, 15, 240, 102, 0xFF996600u);
-          }
-          else {
-            uint8_t* m = &emu->ram[monitorAddr];
-            switch (monitorNibble) {
-              case 0:
-                *m = (*m & 0xF) | (b << 4);
-                break;
-              case 1:
-                *m = (*m & 0xF0) | b;
-                break;
-              case 2:
-                *(m+1) = (*(m+1) & 0xF) | (b << 4);
-                break;
-              case 3:
-                *(m+1) = (*(m+1) & 0xF0) | b;
-                break;
-            }
-            monitorNibble += 1;
-            if (monitorNibble == 4) {
-              monitorNibble = 0;
-              monitorAddr += 2;
-            }
+  if (justPressed) {
+    if (isMonitor) {
+      if (b == KEY_LEFT) {
+        if (monitorAddr >= 0x202) {
+          monitorAddr -= 2;
+          monitorNibble = 0;
+          showMonitorRows(emu);
+        }
+      }
+      else
+      if (b == KEY_RIGHT) {
+        if (monitorAddr < 4 * 1024 - 2) {
+          monitorAddr += 2;
+          monitorNibble = 0;
+          showMonitorRows(emu);
+        }
+      }
+      else
+      if (b == KEY_GO) {
+        // step while paused, otherwise toggle a breakpoint at the cursor
+        if (debug_paused()) {
+          if (!isLiveMonitor) {
+            isLiveMonitor = true;
             showMonitor(emu);
           }
+          debug_step();
         }
         else {
-          // not isMonitor
-          if (b == KEY_LEFT) {
-            if (currPrg > 0) {
-              currPrg -= 1;
-              showCurrPrg(emu);
-            }
-          }
-          else
-          if (b == KEY_RIGHT) {
-            if (currPrg < prgCount - 1) {
-              currPrg += 1;
-              showCurrPrg(emu);
-            }
-          }
-          else
-          if (b == KEY_GO) {
-            loadCurrPrg(emu);
-          }
-          else
-          if (b == KEY_MONITOR) {
-            isMonitor = true;
-            showMonitor(emu);
-          }
+          debug_toggle_break(monitorAddr);
+          showMonitorRow(emu, 1);
         }
       }
-      if (b >= 0) {
-        emu->keys[b] = true;
+      else
+      if (b == KEY_MONITOR) {
+        // paused -> live -> off
+        if (isLiveMonitor) {
+          isMonitor = false;
+          isLiveMonitor = false;
+          debug_continue();
+          lcd.fillRect(0, 15, 240, 113, 0xFF996600u);
+          redraw = true;
+        }
+        else {
+          isLiveMonitor = true;
+          showMonitor(emu);
+        }
+      }
+      else {
+        uint8_t* m = &emu->ram[monitorAddr];
+        switch (monitorNibble) {
+          case 0:
+            *m = (*m & 0xF) | (b << 4);
+            break;
+          case 1:
+            *m = (*m & 0xF0) | b;
+            break;
+          case 2:
+            *(m+1) = (*(m+1) & 0xF) | (b << 4);
+            break;
+          case 3:
+            *(m+1) = (*(m+1) & 0xF0) | b;
+            break;
+        }
+        disasm_cache_update(emu->ram, monitorAddr);
+        monitorNibble += 1;
+        if (monitorNibble == 4) {
+          monitorNibble = 0;
+          monitorAddr += 2;
+          showMonitorRows(emu);
+        }
+        else {
+          showMonitorRow(emu, 1);
+        }
+      }
+    }
+    else {
+      // not isMonitor
+      if (b == KEY_LEFT) {
+        // selects on release unless held to rewind
+        leftPressedAt = millis();
+      }
+      else
+      if (b == KEY_RIGHT) {
+        // held, it jumps to the next initial
+        rightPressedAt = millis();
+        needPrgInfo();
+        if (currPrg < catalog_count() - 1) {
+          currPrg += 1;
+          showCurrPrg(emu);
+        }
+      }
+      else
+      if (b == KEY_GO) {
+        // loads on release unless held to toggle turbo
+        goPressedAt = millis();
       }
+      else
+      if (b == KEY_MONITOR) {
+        // opens the monitor on release unless held to save
+        monitorDown = true;
+        monitorPressedAt = millis();
+      }
+    }
+  }
+  if (b >= 0 && !isMonitor) {
+    if (!emu->keys[b]) {
+      latency_press(b, touchUs);
     }
+    emu->keys[b] = true;
+  }
+  else
+  if (b == KEY_LEFT && !isMonitor && !isRewinding &&
+    millis() - leftPressedAt >= LONG_PRESS &&
+    rewind_enabled() && replay_state() == REPLAY_OFF) {
+    isRewinding = true;
+  }
+  else
+  if (b == KEY_RIGHT && !isMonitor && millis() - rightPressedAt >= LONG_PRESS) {
+    rightPressedAt = millis();
+    nextInitial(emu);
+  }
+  else
+  if (b == KEY_GO && !isMonitor && !goHeld &&
+    millis() - goPressedAt >= LONG_PRESS) {
+    goHeld = true;
+    setTurbo(emu, !isTurbo);
+  }
+  else
+  if (b == KEY_MONITOR && monitorDown && !monitorHeld &&
+    millis() - monitorPressedAt >= LONG_PRESS) {
+    monitorHeld = true;
+    saveSnapshot(emu);
   }
 }
 
 void handleUntouchMain(octo_emulator* emu) {
-  for (int i = 0; i < 20; i++) {
-    if (btn[i].isPressed()) {
-      btn[i].press(false);
-      btn[i].drawButton(false);
+  for (int i = 0; pressedKeys; i++) {
+    if ((pressedKeys >> i) & 1) {
+      pressedKeys &= ~(1u << i);
+      drawKey(i, false);
 
       std::int8_t b = hexButton(i);
       if (b >= 0) {
         emu->keys[b] = false;
       }
+      else
+      if (b == KEY_LEFT && !isMonitor) {
+        if (!isRewinding) {
+          needPrgInfo();
+          if (currPrg > 0) {
+            currPrg -= 1;
+            showCurrPrg(emu);
+          }
+        }
+        isRewinding = false;
+      }
+      else
+      if (b == KEY_GO && !isMonitor) {
+        if (!goHeld) {
+          // the new program is what the next boot resumes, once it ran a while
+          loadCurrPrg(emu);
+          snapshotDue = true;
+          snapshotAt = millis();
+        }
+        goHeld = false;
+      }
+      else
+      if (b == KEY_MONITOR && monitorDown) {
+        if (!monitorHeld) {
+          isMonitor = true;
+          showMonitor(emu);
+        }
+        monitorDown = monitorHeld = false;
+      }
       lcd.fillRect(228, 0, 10, 18, 0xFFFFCC00u);
     }
   }
@@ -964,45 +1892,174 @@ void handleUntouchSave(octo_emulator* emu) {
 unsigned long previousMillis = 0; // will store last time the function was called
 const long interval = 22;// 33; // interval at which to call function (milliseconds)
 
+// Runs as many frames as fit into 3/4 of a tick, the rest is left for
+// drawing the last one and the touch screen
+void turboStep(octo_emulator* emu) {
+  unsigned long start = micros();
+  int n;
+  for (n = 0; n < turboFrames && !emu->halt && !debug_paused(); n++) {
+    emu_step(emu);
+  }
+  unsigned long cost = (micros() - start) / (n ? n : 1);
+  int k = interval * 750 / (cost ? cost : 1);
+  k = k < 1 ? 1 : k > TURBO_MAX ? TURBO_MAX : k;
+  turboFrames = (turboFrames + k + 1) / 2;
+}
+
+void handleTouch(octo_emulator* emu, int touchX, int touchY) {
+  switch (page) {
+    case PAGE_MAIN:
+      handleTouchMain(emu, touchX, touchY);
+      break;
+    case PAGE_SAVE:
+      handleTouchSave(emu, touchX, touchY);
+      break;
+  }
+}
+
+void handleUntouch(octo_emulator* emu) {
+  switch (page) {
+    case PAGE_MAIN:
+      handleUntouchMain(emu);
+      break;
+    case PAGE_SAVE:
+      handleUntouchSave(emu);
+      break;
+  }
+}
+
+// ms until loop() has something to do, it sleeps that long
+long loopIdle(void) {
+#ifdef TARGET_NATIVE
+  if (isUncapped) {
+    return 0;
+  }
+#endif
+  uint16_t x, y;
+  long tick = idle_blocked() && !touch_down(&x, &y) ? LONG_MAX :
+    interval - (long)(millis() - previousMillis);
+  long touch = (touch_idle(micros()) + 999ULL) / 1000;
+  return tick < touch ? tick : touch;
+}
+
 void loop(void)
 {
+  runPendingOps(emu);
+
+  // the panel is only read after a pen-down interrupt and while touched;
+  // presses and releases are handled right away, not on the next tick
+  uint16_t touchX, touchY;
+  if (touch_due(micros())) {
+    bool touched = lcd.getTouch(&touchX, &touchY);
+    touch_sample(touched, touchX, touchY, micros());
+  }
+  touch_event e;
+  bool handled = false;
+  while (touch_next(&e)) {
+    if (e.kind == TOUCH_PRESS) {
+      touchUs = e.us;
+      handleTouch(emu, e.x, e.y);
+    }
+    else {
+      handleUntouch(emu);
+    }
+    handled = true;
+  }
+  if (handled) {
+    idle_wake();
+  }
+
+  // a blocked program needs no frames, unless a key is held
   unsigned long currentMillis = millis();
+  bool due = currentMillis - previousMillis >= interval &&
+    (!idle_blocked() || touch_down(&touchX, &touchY));
+#ifdef TARGET_NATIVE
+  due = due || isUncapped;
+  tickCount += due;
+#endif
 
-  if (currentMillis - previousMillis >= interval) {
+  if (due) {
     // save the last time the function was called
     previousMillis = currentMillis;
 
-    bool touched;
-    uint8_t gesture;
-    uint16_t touchX, touchY;
-
-    touched = lcd.getTouch(&touchX, &touchY);
+    // held keys and long presses
+    if (!handled && touch_down(&touchX, &touchY)) {
+      touchUs = micros();
+      handleTouch(emu, touchX, touchY);
+    }
 
-    if (touched) {
-      switch (page) {
-        case PAGE_MAIN:
-          handleTouchMain(emu, touchX, touchY);
-        case PAGE_SAVE:
-          handleTouchSave(emu, touchX, touchY);
+    static uint32_t stopsShown = 0;
+    if (page == PAGE_MAIN && (!isMonitor || isLiveMonitor)) { 
+      unsigned long start = micros();
+      if (isRewinding) {
+        for (int n = 0; n < REWIND_SPEED && rewind_step(emu); n++) {
+          redraw = true;
+        }
+        screen_pack(emu);
+      }
+      else
+      if (isTurbo && replay_state() != REPLAY_PLAY) {
+        turboStep(emu);
+      }
+      else {
+        emu_step(emu);
+      }
+      bool drawn = ui_run(emu);
+      // the push is complete when ui_run() returns
+      if (drawn) {
+        latency_drawn(micros());
+      }
+      static bool shown = false;
+      if (drawn && !shown) {
+        shown = true;
+        console_printf("First frame after %lu ms\r\n", millis());
+      }
+      if (!isRewinding && replay_state() != REPLAY_PLAY) {
+        idle_frame(emu, drawn);
+      }
+      if (replay_state() == REPLAY_PLAY) {
+        replay_timing(micros() - start);
+      }
+      if (replay_finished()) {
+        char report[160 + REPLAY_PATH_MAX];
+        replay_report(emu, report, sizeof(report));
+        console_printf("Replay done: %s\r\n", report);
+        if (latency_enabled()) {
+          latency_report();
+        }
       }
     }
-    else {
-      // not touched
-      switch (page) {
-        case PAGE_MAIN:
-          handleUntouchMain(emu);
-        case PAGE_SAVE:
-          handleUntouchSave(emu);
+    // every tick, a frame that didn't run (paused, the monitor) is silent
+    audio_update(emu);
+    if (debug_stops() != stopsShown) {
+      stopsShown = debug_stops();
+      if (debug_paused()) {
+        showDebugStop(emu);
       }
     }
-
-    if (page == PAGE_MAIN && !isMonitor) { 
-      emu_step(emu);
-      ui_run(emu);
+    if (isLiveMonitor) {
+      updateLiveMonitor(emu);
     }
   }
+  if (snapshotDue && millis() - snapshotAt >= SNAPSHOT_INTERVAL) {
+    saveSnapshot(emu);
+  }
+#ifndef TARGET_NATIVE
+  // keep the game should the battery run out while asleep
+  if (idle_blocked() && lightSleepMs() > 0) {
+    saveSnapshot(emu);
+  }
+  // without the radio only a touch or the timer for the next attempt wakes us
+  idle_sleep(loopIdle(), lightSleepMs());
+#endif
 }
 
+#ifdef TARGET_NATIVE
+unsigned long loopTicks(void) {
+  return tickCount;
+}
+#endif
+
 #if defined ( ESP_PLATFORM ) && !defined ( ARDUINO )
 extern "C" {
 int app_main(int, char**)
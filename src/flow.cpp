@@ -0,0 +1,195 @@
+/**
+ * Static control-flow analysis of the loaded ROM.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "disasm.h"
+#include "flow.h"
+
+static uint8_t* code;     // an instruction starts here
+static uint8_t* target;   // destination of a jump or call
+static uint8_t* covered;  // byte belongs to an instruction
+static uint16_t base;
+static uint32_t end;
+
+static uint16_t* work;
+static int workCount;
+static int workSpace;
+static int found;         // instructions marked
+
+static inline bool test(const uint8_t* map, uint16_t addr) {
+  return addr >= base && addr < end && (map[(addr - base) >> 3] >> ((addr - base) & 7)) & 1;
+}
+
+static inline void set(uint8_t* map, uint16_t addr) {
+  map[(addr - base) >> 3] |= 1 << ((addr - base) & 7);
+}
+
+static inline uint16_t word(const uint8_t* ram, uint16_t addr) {
+  return (ram[addr] << 8) | ram[(uint16_t)(addr + 1)];
+}
+
+static bool push(uint16_t addr) {
+  if (addr < base || addr >= end || test(code, addr)) {
+    return true;
+  }
+  if (workCount == workSpace) {
+    workSpace += 64;
+    uint16_t* w = (uint16_t*)realloc(work, workSpace * sizeof(uint16_t));
+    if (!w) {
+      return false;
+    }
+    work = w;
+  }
+  work[workCount++] = addr;
+  return true;
+}
+
+static bool branch(uint16_t addr) {
+  if (addr >= base && addr < end) {
+    set(target, addr);
+  }
+  return push(addr);
+}
+
+// Follows one path until it ends in a jump, return or exit
+static bool trace(const uint8_t* ram, uint16_t addr) {
+  while (addr >= base && addr < end && !test(code, addr)) {
+    uint8_t token = disasm_token(ram, addr);
+    uint8_t size = disasm_length(token);
+    if (token == DISASM_UNKNOWN || addr + size > end) {
+      return true;
+    }
+
+    set(code, addr);
+    found++;
+    for (int n = 0; n < size; n++) {
+      set(covered, addr + n);
+    }
+
+    uint16_t wd = word(ram, addr);
+    uint16_t nnn = wd & 0xFFF;
+    uint16_t next = addr + size;
+
+    switch (wd >> 12) {
+      case 0x0:
+        if (wd != 0x00E0 && (wd & 0xFFE0) != 0x00C0 && wd != 0x00FB && wd != 0x00FC &&
+            wd != 0x00FE && wd != 0x00FF) {
+          // ret, exit or a machine code routine
+          return true;
+        }
+        break;
+      case 0x1:
+        return branch(nnn);
+      case 0x2:
+        if (!branch(nnn)) {
+          return false;
+        }
+        break;
+      case 0x3:
+      case 0x4:
+      case 0x5:
+      case 0x9:
+      case 0xE:
+        if ((wd >> 12) == 0x5 && (wd & 0xF) != 0) {
+          // ranged load/store, not a skip
+          break;
+        }
+        // skips jump over a whole instruction, "ld i,long" included
+        if (!push(next + disasm_length(disasm_token(ram, next)))) {
+          return false;
+        }
+        break;
+      case 0xB:
+        // jp v0: the usual target is a table of jumps
+        for (uint16_t t = nnn; t >= base && t < end; t += 2) {
+          if (!branch(t)) {
+            return false;
+          }
+          if ((word(ram, t) >> 12) != 0x1) {
+            break;
+          }
+        }
+        return true;
+    }
+    addr = next;
+  }
+  return true;
+}
+
+void flow_clear(void) {
+  free(code);
+  free(target);
+  free(covered);
+  code = target = covered = NULL;
+  base = end = 0;
+}
+
+// Traces everything reachable from what was pushed, ok false if that failed
+static bool follow(const uint8_t* ram, bool ok) {
+  while (ok && workCount) {
+    ok = trace(ram, work[--workCount]);
+  }
+  free(work);
+  work = NULL;
+  workSpace = 0;
+  return ok;
+}
+
+bool flow_analyse(const uint8_t* ram, uint16_t from, uint32_t to) {
+  flow_clear();
+  if (to <= from) {
+    return false;
+  }
+
+  size_t size = (to - from + 7) / 8;
+  code = (uint8_t*)calloc(size, 1);
+  target = (uint8_t*)calloc(size, 1);
+  covered = (uint8_t*)calloc(size, 1);
+  base = from;
+  end = to;
+
+  workCount = 0;
+  bool ok = code && target && covered && follow(ram, branch(from));
+  if (!ok) {
+    flow_clear();
+  }
+  return ok;
+}
+
+int flow_follow(const uint8_t* ram, uint16_t addr) {
+  if (!code) {
+    return 0;
+  }
+  // an instruction already known is traced again, it may have changed
+  found = 0;
+  if (test(code, addr)) {
+    code[(addr - base) >> 3] &= ~(1 << ((addr - base) & 7));
+    found--;
+  }
+  workCount = 0;
+  return follow(ram, push(addr)) ? found : -1;
+}
+
+bool flow_valid(void) {
+  return code != NULL;
+}
+
+bool flow_is_code(uint16_t addr) {
+  return code && test(code, addr);
+}
+
+bool flow_is_target(uint16_t addr) {
+  return code && test(target, addr);
+}
+
+bool flow_is_data(uint16_t addr) {
+  return code && addr >= base && addr < end && !test(covered, addr);
+}
+
+const uint8_t* flow_code_bitmap(uint16_t* b, uint32_t* size) {
+  *b = base;
+  *size = end - base;
+  return code;
+}
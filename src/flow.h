@@ -0,0 +1,48 @@
+/**
+ * Static control-flow analysis of the loaded ROM.
+ *
+ * Follows jumps, calls, skips and "jp v0" tables from the entry point and
+ * separates code from data (sprites, tables, odd-aligned gaps). The result
+ * is a set of bitmaps over the ROM, one bit per byte address.
+ */
+#ifndef _FLOW_H
+#define _FLOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus          // fs/ch8toec8 is C
+extern "C" {
+#endif
+
+// Analyses [from, to), entering at from. Returns false if out of memory.
+bool flow_analyse(const uint8_t* ram, uint16_t from, uint32_t to);
+
+// Marks addr as code and follows it like flow_analyse() does the entry,
+// for instructions entered by hand. Returns the number of instructions
+// found, -1 if out of memory (the result is then incomplete).
+int flow_follow(const uint8_t* ram, uint16_t addr);
+
+void flow_clear(void);
+
+// True if an analysis result is available
+bool flow_valid(void);
+
+// An instruction starts at addr
+bool flow_is_code(uint16_t addr);
+
+// addr is the destination of a jp, call or jp v0
+bool flow_is_target(uint16_t addr);
+
+// The byte at addr isn't part of any reachable instruction
+bool flow_is_data(uint16_t addr);
+
+// Raw bitmap of instruction starts; bit (addr - base) & 7 of byte (addr - base) >> 3
+const uint8_t* flow_code_bitmap(uint16_t* base, uint32_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * Idle detection and power saving.
+ */
+#include <limits.h>
+
+#ifndef TARGET_NATIVE
+# include <Arduino.h>
+# include <driver/gpio.h>
+# include <esp_sleep.h>
+#endif
+
+#include "console.h"
+#include "idle.h"
+#include "touch.h"
+
+static idle_state state;
+static idle_state seen;         // what the last frames looked like
+static uint32_t frames;         // how many in a row
+static volatile bool woken;     // idle_wake() since the last check
+
+static int wakePin = -1;
+#ifndef TARGET_NATIVE
+static TaskHandle_t loopTask;
+static uint32_t busyMhz;
+#endif
+
+static const char* const names[] = { "busy", "static", "key wait", "halted" };
+
+static void enter(idle_state s) {
+  if (s == state) {
+    return;
+  }
+#ifndef TARGET_NATIVE
+  if (s == IDLE_BUSY) {
+    setCpuFrequencyMhz(busyMhz);
+  }
+  else
+  if (state == IDLE_BUSY) {
+    setCpuFrequencyMhz(IDLE_MHZ);
+  }
+#endif
+  console_debug("idle: %s\r\n", names[s]);
+  state = s;
+}
+
+void idle_init(int pin) {
+  wakePin = pin;
+#ifndef TARGET_NATIVE
+  loopTask = xTaskGetCurrentTaskHandle();
+  busyMhz = getCpuFrequencyMhz();
+#endif
+}
+
+void idle_wake(void) {
+  woken = true;
+#ifndef TARGET_NATIVE
+  if (loopTask) {
+    xTaskNotifyGive(loopTask);
+  }
+#endif
+}
+
+#ifndef TARGET_NATIVE
+void IRAM_ATTR idle_wake_isr(void) {
+  woken = true;
+  if (loopTask) {
+    BaseType_t higher = pdFALSE;
+    vTaskNotifyGiveFromISR(loopTask, &higher);
+    if (higher) {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+#else
+void idle_wake_isr(void) {
+  woken = true;
+}
+#endif
+
+// Takes a pending idle_wake()
+static void check(void) {
+  if (woken) {
+    woken = false;
+    seen = IDLE_BUSY;
+    frames = 0;
+    enter(IDLE_BUSY);
+  }
+}
+
+idle_state idle_frame(const octo_emulator* emu, bool drawn) {
+  check();
+  idle_state now = IDLE_BUSY;
+  if (!emu->dt && !emu->st) {
+    now = emu->halt ? IDLE_HALTED : emu->wait ? IDLE_KEYWAIT : drawn ? IDLE_BUSY : IDLE_STATIC;
+  }
+  if (now != seen) {
+    seen = now;
+    frames = 0;
+  }
+  frames++;
+  uint32_t needed = now == IDLE_STATIC ? IDLE_STATIC_FRAMES : IDLE_BLOCKED_FRAMES;
+  enter(now != IDLE_BUSY && frames >= needed ? now : IDLE_BUSY);
+  return state;
+}
+
+idle_state idle_current(void) {
+  return state;
+}
+
+bool idle_blocked(void) {
+  check();
+  return state >= IDLE_KEYWAIT;
+}
+
+#ifndef TARGET_NATIVE
+static void lightSleep(long ms) {
+  console_info("idle: light sleep\r\n");
+  console_flush();
+  gpio_wakeup_enable((gpio_num_t)wakePin, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  if (ms < LONG_MAX) {
+    esp_sleep_enable_timer_wakeup(ms * 1000ULL);
+  }
+  esp_light_sleep_start();
+  bool touched = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  gpio_wakeup_disable((gpio_num_t)wakePin);
+  // the wakeup replaced attachInterrupt()'s edge trigger
+  gpio_set_intr_type((gpio_num_t)wakePin, GPIO_INTR_NEGEDGE);
+  if (touched) {
+    // no edge was seen while asleep, the touch that woke us is read now
+    touch_notify();
+    idle_wake();
+  }
+}
+#endif
+
+void idle_sleep(long ms, long light) {
+#ifndef TARGET_NATIVE
+  if (ms <= 0) {
+    return;
+  }
+  if (light > 0 && wakePin >= 0 && idle_blocked() && digitalRead(wakePin) == HIGH) {
+    lightSleep(light < ms ? light : ms);
+    return;
+  }
+  // anything over an hour is for good
+  ulTaskNotifyTake(pdTRUE, ms < 3600000L ? pdMS_TO_TICKS(ms) : portMAX_DELAY);
+#endif
+}
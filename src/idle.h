@@ -0,0 +1,48 @@
+/**
+ * Idle detection and power saving.
+ *
+ * A program that halted, waits in Fx0A for a key, or hasn't changed the
+ * display for a while with both timers stopped only reacts to input. The
+ * clock is lowered then, and a blocked program isn't emulated at all: the
+ * loop sleeps until a touch or a web request, in light sleep woken by the
+ * touch interrupt line when the radio is off.
+ */
+#ifndef _IDLE_H
+#define _IDLE_H
+
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#define IDLE_STATIC_FRAMES 450    // ~10 s of an unchanged display
+#define IDLE_BLOCKED_FRAMES 45    // ~1 s halted or waiting for a key
+#define IDLE_MHZ 80               // lowest clock WiFi still works at
+
+enum idle_state {
+  IDLE_BUSY,
+  IDLE_STATIC,    // still emulated, only slower
+  IDLE_KEYWAIT,   // blocked from here on
+  IDLE_HALTED
+};
+
+// pin is the active low wakeup line for light sleep, < 0 for none
+void idle_init(int pin);
+
+// Input or a web request: back to full speed. Safe from other tasks.
+void idle_wake(void);
+// The same from an interrupt handler
+void idle_wake_isr(void);
+
+// Call after each emulated frame, drawn if the display changed
+idle_state idle_frame(const octo_emulator* emu, bool drawn);
+
+idle_state idle_current(void);
+
+// True if no frames need to be emulated until idle_wake()
+bool idle_blocked(void);
+
+// Waits up to ms, or until idle_wake(). Blocked, it light-sleeps instead
+// for up to light ms (LONG_MAX: as long as ms), or until the wakeup line
+// goes low; light <= 0 allows no light sleep.
+void idle_sleep(long ms, long light);
+
+#endif
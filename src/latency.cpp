@@ -0,0 +1,170 @@
+/**
+ * Input-to-photon latency probe.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "console.h"
+#include "latency.h"
+
+enum Stage {
+  IDLE,
+  READING,      // pressed, not read yet
+  DRAWING       // read, waiting for the next frame
+};
+
+struct Histogram {
+  uint32_t counts[LATENCY_BUCKETS];
+  uint32_t n;
+  uint32_t maxUs;
+  uint64_t totalUs;
+};
+
+static bool enabled;
+static Stage stage;
+static int probeKey;
+static uint32_t pressedUs;
+
+static Histogram toRead, toPhoton;
+static uint32_t presses;
+static uint32_t unread;         // timed out or replaced before the read
+
+static void add(Histogram* h, uint32_t us) {
+  int b = 0;
+  for (uint32_t limit = 1000; b < LATENCY_BUCKETS - 1 && us >= limit; limit *= 2) {
+    b++;
+  }
+  h->counts[b]++;
+  h->n++;
+  h->totalUs += us;
+  if (us > h->maxUs) {
+    h->maxUs = us;
+  }
+}
+
+void latency_enable(bool on) {
+  enabled = on;
+  stage = IDLE;
+}
+
+bool latency_enabled(void) {
+  return enabled;
+}
+
+void latency_reset(void) {
+  memset(&toRead, 0, sizeof(toRead));
+  memset(&toPhoton, 0, sizeof(toPhoton));
+  presses = unread = 0;
+  stage = IDLE;
+}
+
+void latency_press(int key, uint32_t us) {
+  if (!enabled) {
+    return;
+  }
+  if (stage == READING) {
+    unread++;
+  }
+  presses++;
+  probeKey = key;
+  pressedUs = us;
+  stage = READING;
+}
+
+bool latency_reading(void) {
+  return stage == READING;
+}
+
+// Moves on to drawing if reads, gives up on a key that is never read
+static bool noteRead(bool reads, uint32_t now) {
+  if (stage != READING) {
+    return false;
+  }
+  if (now - pressedUs > LATENCY_TIMEOUT) {
+    unread++;
+    stage = IDLE;
+    return false;
+  }
+  if (!reads) {
+    return false;
+  }
+  add(&toRead, now - pressedUs);
+  stage = DRAWING;
+  return true;
+}
+
+bool latency_instruction(const octo_emulator* emu, uint32_t now) {
+  const uint8_t op = emu->ram[emu->pc & OCTO_RAM_MASK];
+  const uint8_t arg = emu->ram[(emu->pc + 1) & OCTO_RAM_MASK];
+  return noteRead(emu->wait || ((op & 0xF0) == 0xF0 && arg == 0x0A) ||
+    ((op & 0xF0) == 0xE0 && (arg == 0x9E || arg == 0xA1) && (emu->v[op & 0xF] & 0xF) == probeKey), now);
+}
+
+bool latency_key(int key, uint32_t now) {
+  return noteRead((key & 0xF) == probeKey, now);
+}
+
+void latency_drawn(uint32_t now) {
+  if (stage != DRAWING) {
+    return;
+  }
+  add(&toPhoton, now - pressedUs);
+  stage = IDLE;
+  console_debug("latency: key %X photon %lu us\r\n", probeKey, (unsigned long)(now - pressedUs));
+  if (toPhoton.n % LATENCY_REPORT == 0) {
+    latency_report();
+  }
+}
+
+static size_t json(char* buf, size_t size, const char* name, const Histogram* h) {
+  int len = snprintf(buf, size, "\"%s\":{\"n\":%u,\"avgUs\":%u,\"maxUs\":%u,\"buckets\":[",
+    name, (unsigned)h->n, (unsigned)(h->n ? h->totalUs / h->n : 0), (unsigned)h->maxUs);
+  for (int b = 0; b < LATENCY_BUCKETS && len < (int)size; b++) {
+    len += snprintf(buf + len, size - len, b ? ",%u" : "%u", (unsigned)h->counts[b]);
+  }
+  if (len < (int)size) {
+    len += snprintf(buf + len, size - len, "]}");
+  }
+  return len < (int)size ? len : size - 1;
+}
+
+size_t latency_stats(char* buf, size_t size) {
+  size_t len = snprintf(buf, size, "{\"enabled\":%s,\"presses\":%u,\"unread\":%u,\"bucketMs\":1,",
+    enabled ? "true" : "false", (unsigned)presses, (unsigned)unread);
+  if (len < size) {
+    len += json(buf + len, size - len, "read", &toRead);
+  }
+  if (len < size) {
+    len += snprintf(buf + len, size - len, ",");
+  }
+  if (len < size) {
+    len += json(buf + len, size - len, "photon", &toPhoton);
+  }
+  if (len < size) {
+    len += snprintf(buf + len, size - len, "}");
+  }
+  return len < size ? len : size - 1;
+}
+
+// One line per histogram, the report fits the console queue
+static void print(const char* name, const Histogram* h) {
+  char buckets[CONSOLE_TEXT - 16];
+  int len = 0;
+  uint32_t limit = 1;
+  for (int b = 0; b < LATENCY_BUCKETS && len < (int)sizeof(buckets); b++, limit *= 2) {
+    if (!h->counts[b]) {
+      continue;
+    }
+    len += snprintf(buckets + len, sizeof(buckets) - len, b < LATENCY_BUCKETS - 1 ? " <%u:%u" : " >=%u:%u",
+      (unsigned)(b < LATENCY_BUCKETS - 1 ? limit : limit / 2), (unsigned)h->counts[b]);
+  }
+  buckets[len < (int)sizeof(buckets) ? len : sizeof(buckets) - 1] = '\0';
+  console_printf("%s: %u, avg %u us, max %u us, ms:%s\r\n", name, (unsigned)h->n,
+    (unsigned)(h->n ? h->totalUs / h->n : 0), (unsigned)h->maxUs, buckets);
+}
+
+void latency_report(void) {
+  console_printf("Latency of %u presses, %u not read\r\n", (unsigned)presses, (unsigned)unread);
+  print("Event to read", &toRead);
+  print("Event to photon", &toPhoton);
+}
@@ -0,0 +1,46 @@
+/**
+ * Input-to-photon latency probe.
+ *
+ * A key press starts a probe at the time of its event. The probe notes
+ * the first instruction reading that key (EX9E or EXA1 on it, or FX0A),
+ * then the end of the push of the first frame drawn after that read. The
+ * delays from the event to both are kept as histograms with doubling
+ * buckets. One probe runs at a time, a press replaces an unanswered one.
+ */
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#define LATENCY_BUCKETS 11        // < 1, 2, 4 ... 512 ms, the rest
+#define LATENCY_TIMEOUT 1000000   // us until a key that isn't read is given up
+#define LATENCY_REPORT 32         // drawn probes between serial reports
+
+void latency_enable(bool on);
+bool latency_enabled(void);
+// Clears the histograms
+void latency_reset(void);
+
+// key went down, us is micros() of the event
+void latency_press(int key, uint32_t us);
+
+// True while a probe waits for the program to read its key
+bool latency_reading(void);
+// Call before each instruction while latency_reading(), true when this
+// one reads the key
+bool latency_instruction(const octo_emulator* emu, uint32_t now);
+// The same for a key test of translated code (EX9E or EXA1 on key)
+bool latency_key(int key, uint32_t now);
+
+// Call when a frame has been pushed to the display
+void latency_drawn(uint32_t now);
+
+// Writes the counts and histograms as JSON, returns the length
+size_t latency_stats(char* buf, size_t size);
+
+// Prints the histograms to the console
+void latency_report(void);
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * Counting profiler: instruction hits per address and sprite draws per frame.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+#ifndef TARGET_NATIVE
+# include <SPIFFS.h>
+#endif
+
+#include "profiler.h"
+#include "screen.h"
+
+static uint32_t* hits;
+static uint16_t base;
+static uint32_t size;
+static bool enabled;
+// held while hits is replaced or copied, exports run on the web server
+static std::mutex hitsLock;
+
+static uint32_t frames;
+static uint32_t instructions;
+static uint32_t draws;          // total
+static uint32_t maxDraws;       // most in one frame
+static uint16_t frameDraws;     // in the current frame
+static uint16_t recent[PROFILE_FRAMES];
+static int recentNext;
+
+static const uint32_t MAGIC = 0x46525045;   // "EPRF"
+
+// the counts follow the copy's head
+static_assert(offsetof(profile_copy, head) + sizeof(((profile_copy*)0)->head) == sizeof(profile_copy),
+  "padding after profile_copy::head");
+
+static inline uint32_t* counts(const profile_copy* copy) {
+  return (uint32_t*)(copy + 1);
+}
+
+static void reset(uint32_t* to, uint16_t from, uint32_t n) {
+  std::lock_guard<std::mutex> lock(hitsLock);
+  free(hits);
+  hits = to;
+  base = from;
+  size = n;
+  enabled = to != NULL;
+  frames = instructions = draws = maxDraws = 0;
+  frameDraws = 0;
+  memset(recent, 0, sizeof(recent));
+  recentNext = 0;
+}
+
+bool profile_start(uint16_t from, uint32_t to) {
+  uint32_t* h = to > from ? (uint32_t*)calloc(to - from, sizeof(uint32_t)) : NULL;
+  reset(h, h ? from : 0, h ? to - from : 0);
+  return h != NULL;
+}
+
+void profile_stop(void) {
+  enabled = false;
+}
+
+void profile_clear(void) {
+  reset(NULL, 0, 0);
+}
+
+bool profile_enabled(void) {
+  return enabled;
+}
+
+void profile_instruction(const octo_emulator* emu) {
+  uint16_t pc = emu->pc;
+  if ((uint16_t)(pc - base) < size) {
+    hits[pc - base]++;
+  }
+  if ((emu->ram[pc] & 0xF0) == 0xD0) {
+    frameDraws++;
+  }
+  instructions++;
+}
+
+void profile_frame(void) {
+  if (!enabled) {
+    return;
+  }
+  frames++;
+  draws += frameDraws;
+  if (frameDraws > maxDraws) {
+    maxDraws = frameDraws;
+  }
+  recent[recentNext] = frameDraws;
+  recentNext = (recentNext + 1) % PROFILE_FRAMES;
+  frameDraws = 0;
+}
+
+void profile_run(octo_emulator* emu, int cycles) {
+  for (int z = 0; z < cycles && !emu->halt; z++) {
+    if (emu->options.q_vblank && (emu->ram[emu->pc] & 0xF0) == 0xD0) {
+      z = cycles;
+    }
+    profile_instruction(emu);
+    screen_instruction(emu);
+  }
+}
+
+profile_copy* profile_snapshot(void) {
+  std::lock_guard<std::mutex> lock(hitsLock);
+  if (!hits) {
+    return NULL;
+  }
+  profile_copy* copy = (profile_copy*)malloc(sizeof(profile_copy) + size * sizeof(uint32_t));
+  if (!copy) {
+    return NULL;
+  }
+  copy->instructions = instructions;
+  copy->maxDraws = maxDraws;
+  for (int n = 0; n < PROFILE_FRAMES; n++) {
+    copy->recent[n] = recent[(recentNext + n) % PROFILE_FRAMES];
+  }
+  uint32_t head[5] = { MAGIC, base, size, frames, draws };
+  memcpy(copy->head, head, sizeof(head));
+  memcpy(counts(copy), hits, size * sizeof(uint32_t));
+  return copy;
+}
+
+uint32_t profile_copy_hits(const profile_copy* copy, uint16_t addr) {
+  uint16_t n = addr - copy->head[1];
+  return n < copy->head[2] ? counts(copy)[n] : 0;
+}
+
+// Formats item n of the JSON export into item: 0 is the header, then one
+// "addr":count pair per address (empty without hits), then the end
+static size_t jsonItem(const profile_copy* copy, uint32_t n, bool comma, char* item, size_t size) {
+  const uint32_t* head = copy->head;
+  if (n == 0) {
+    size_t len = snprintf(item, size,
+      "{\"from\":%u,\"size\":%u,\"frames\":%u,\"instructions\":%u,"
+      "\"draws\":%u,\"maxDraws\":%u,\"recentDraws\":[",
+      (unsigned)head[1], (unsigned)head[2], (unsigned)head[3], (unsigned)copy->instructions,
+      (unsigned)head[4], (unsigned)copy->maxDraws);
+    for (int k = 0; k < PROFILE_FRAMES && len < size; k++) {
+      len += snprintf(item + len, size - len, k ? ",%u" : "%u", (unsigned)copy->recent[k]);
+    }
+    if (len < size) {
+      len += snprintf(item + len, size - len, "],\"hits\":{");
+    }
+    return len < size ? len : size - 1;
+  }
+  if (n <= head[2]) {
+    uint32_t h = counts(copy)[n - 1];
+    return h ? snprintf(item, size, comma ? ",\"%u\":%u" : "\"%u\":%u",
+      (unsigned)(head[1] + n - 1), (unsigned)h) : 0;
+  }
+  return snprintf(item, size, "}}");
+}
+
+size_t profile_json(const profile_copy* copy, char* buf, size_t bufSize, uint32_t* cursor) {
+  // the item below, how much of it was written above; WROTE once a pair was
+  const uint32_t ITEM = 0xFFFFF;
+  const int SKIP = 20;
+  const uint32_t WROTE = 0x80000000u;
+  char item[600];     // the header needs about 500 bytes
+  size_t len = 0;
+
+  while (len < bufSize && (*cursor & ITEM) <= copy->head[2] + 1) {
+    uint32_t n = *cursor & ITEM;
+    size_t l = jsonItem(copy, n, *cursor & WROTE, item, sizeof(item));
+    size_t skip = (*cursor & ~WROTE) >> SKIP;
+    size_t part = l - skip < bufSize - len ? l - skip : bufSize - len;
+    memcpy(buf + len, item + skip, part);
+    len += part;
+    if (skip + part < l) {
+      // the rest of it goes into the next buffer
+      *cursor = (*cursor & (WROTE | ITEM)) | (uint32_t)(skip + part) << SKIP;
+      break;
+    }
+    *cursor = (*cursor & WROTE) | (n + 1);
+    if (l && n > 0 && n <= copy->head[2]) {
+      *cursor |= WROTE;
+    }
+  }
+  return len;
+}
+
+size_t profile_bin(const profile_copy* copy, uint8_t* buf, size_t bufSize, uint32_t* cursor) {
+  size_t total = (5 + copy->head[2]) * sizeof(uint32_t);
+  size_t len = total - *cursor < bufSize ? total - *cursor : bufSize;
+  memcpy(buf, (const uint8_t*)copy->head + *cursor, len);
+  *cursor += len;
+  return len;
+}
+
+bool profile_save(const char* romPath) {
+  profile_copy* copy = profile_snapshot();
+  if (!copy) {
+    return false;
+  }
+  const char* dot = strrchr(romPath, '.');
+  size_t stem = dot ? dot - romPath : strlen(romPath);
+  char* path = (char*)malloc(stem + 6);
+  memcpy(path, romPath, stem);
+  strcpy(path + stem, ".prof");
+
+  size_t bytes = (5 + copy->head[2]) * sizeof(uint32_t);
+  bool ok = false;
+
+#ifdef TARGET_NATIVE
+  FILE* f = fopen(path, "wb");
+  if (f) {
+    ok = fwrite(copy->head, bytes, 1, f) == 1;
+    fclose(f);
+  }
+#else
+  File f = SPIFFS.open(path, FILE_WRITE);
+  if (f) {
+    ok = f.write((const uint8_t*)copy->head, bytes) == bytes;
+    f.close();
+  }
+#endif
+  free(path);
+  free(copy);
+  return ok;
+}
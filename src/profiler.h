@@ -0,0 +1,58 @@
+/**
+ * Counting profiler: instruction hits per address and sprite draws per frame.
+ *
+ * Like the debugger, it only costs time while enabled: emu_step() then runs
+ * profile_run() instead of the plain interpreter loop.
+ */
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+// Frames whose draw counts are kept
+#define PROFILE_FRAMES 64
+
+// Starts counting for addresses [from, to). Returns false if out of memory.
+bool profile_start(uint16_t from, uint32_t to);
+// Stops counting, the data stays available
+void profile_stop(void);
+// Stops and frees the data
+void profile_clear(void);
+
+bool profile_enabled(void);
+
+// Counts the instruction at pc, call before executing it
+void profile_instruction(const octo_emulator* emu);
+// Call at the end of each frame
+void profile_frame(void);
+
+// Runs up to cycles instructions while counting them
+void profile_run(octo_emulator* emu, int cycles);
+
+// A copy of the counts, exported while the program goes on counting.
+// Released with free().
+struct profile_copy {
+  uint32_t instructions;
+  uint32_t maxDraws;
+  uint16_t recent[PROFILE_FRAMES];    // draws of the last frames, oldest first
+  uint32_t head[5];                   // the binary export starts here,
+                                      // the counts follow it
+};
+
+// NULL if there are no counts or no memory for them
+profile_copy* profile_snapshot(void);
+uint32_t profile_copy_hits(const profile_copy* copy, uint16_t addr);
+
+// Write the next part of an export of copy into buf; *cursor starts at 0
+// and keeps the position between calls. They fill buf as far as there is
+// anything left and return 0 when done.
+size_t profile_json(const profile_copy* copy, char* buf, size_t size, uint32_t* cursor);
+size_t profile_bin(const profile_copy* copy, uint8_t* buf, size_t size, uint32_t* cursor);
+
+// Writes the binary export ("EPRF", from, size, frames, draws, counts;
+// little endian) next to the ROM as <rom>.prof
+bool profile_save(const char* romPath);
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * Deterministic input recording and replay.
+ *
+ * Log format (little endian): "EREC", seed, frames, events, path[64],
+ * then events of (frame, key mask) as two 32-bit words.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TARGET_NATIVE
+# include <SPIFFS.h>
+#endif
+
+#include "replay.h"
+
+struct Header {
+  uint32_t magic;
+  uint32_t seed;
+  uint32_t frames;
+  uint32_t events;
+  char path[REPLAY_PATH_MAX];
+};
+
+struct Event {
+  uint32_t frame;
+  uint32_t keys;
+};
+
+static const uint32_t MAGIC = 0x43455245;  // "EREC"
+
+static replay_mode mode;
+static Header header;
+static Event* events;
+static uint32_t eventSpace;
+static uint32_t frame;
+static uint32_t next;       // next event to play
+static uint32_t keys;       // current mask
+static bool finished;
+
+// frame times of the last playback
+static uint32_t timed;
+static uint64_t totalUs;
+static uint32_t minUs;
+static uint32_t maxUs;
+
+replay_mode replay_state(void) {
+  return mode;
+}
+
+static void reset(void) {
+  free(events);
+  events = NULL;
+  eventSpace = 0;
+  frame = next = keys = 0;
+  timed = 0;
+  totalUs = 0;
+  minUs = UINT32_MAX;
+  maxUs = 0;
+}
+
+bool replay_record(const char* romPath, uint32_t seed) {
+  reset();
+  memset(&header, 0, sizeof(header));
+  header.magic = MAGIC;
+  header.seed = seed;
+  strncpy(header.path, romPath, REPLAY_PATH_MAX - 1);
+  mode = REPLAY_RECORD;
+  return true;
+}
+
+static bool append(uint32_t mask) {
+  if (header.events == eventSpace) {
+    Event* e = (Event*)realloc(events, (eventSpace + 64) * sizeof(Event));
+    if (!e) {
+      return false;
+    }
+    events = e;
+    eventSpace += 64;
+  }
+  events[header.events].frame = frame;
+  events[header.events].keys = mask;
+  header.events++;
+  return true;
+}
+
+bool replay_save(const char* path) {
+  if (mode != REPLAY_RECORD) {
+    return false;
+  }
+  mode = REPLAY_OFF;
+  header.frames = frame;
+
+  bool ok = false;
+  size_t size = header.events * sizeof(Event);
+#ifdef TARGET_NATIVE
+  FILE* f = fopen(path, "wb");
+  if (f) {
+    ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+      (!size || fwrite(events, size, 1, f) == 1);
+    fclose(f);
+  }
+#else
+  File f = SPIFFS.open(path, FILE_WRITE);
+  if (f) {
+    ok = f.write((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+      f.write((uint8_t*)events, size) == size;
+    f.close();
+  }
+#endif
+  reset();
+  return ok;
+}
+
+bool replay_load(const char* path, char* romPath, uint32_t* seed) {
+  replay_stop();
+  reset();
+
+  bool ok = false;
+#ifdef TARGET_NATIVE
+  FILE* f = fopen(path, "rb");
+  if (f) {
+    ok = fread(&header, sizeof(header), 1, f) == 1 && header.magic == MAGIC;
+    if (ok) {
+      events = (Event*)malloc(header.events * sizeof(Event) + 1);
+      ok = events && fread(events, sizeof(Event), header.events, f) == header.events;
+    }
+    fclose(f);
+  }
+#else
+  File f = SPIFFS.open(path);
+  if (f) {
+    ok = f.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && header.magic == MAGIC;
+    if (ok) {
+      size_t size = header.events * sizeof(Event);
+      events = (Event*)malloc(size + 1);
+      ok = events && f.read((uint8_t*)events, size) == size;
+    }
+    f.close();
+  }
+#endif
+  if (!ok) {
+    reset();
+    return false;
+  }
+  header.path[REPLAY_PATH_MAX - 1] = '\0';
+  strcpy(romPath, header.path);
+  *seed = header.seed;
+  return true;
+}
+
+void replay_play(void) {
+  frame = next = keys = 0;
+  finished = false;
+  mode = REPLAY_PLAY;
+}
+
+void replay_stop(void) {
+  mode = REPLAY_OFF;
+}
+
+void replay_input(octo_emulator* emu) {
+  if (mode == REPLAY_RECORD) {
+    uint32_t mask = 0;
+    for (int k = 0; k < 16; k++) {
+      if (emu->keys[k]) {
+        mask |= 1 << k;
+      }
+    }
+    if (mask != keys) {
+      keys = mask;
+      append(mask);
+    }
+    frame++;
+  }
+  else
+  if (mode == REPLAY_PLAY) {
+    if (frame >= header.frames) {
+      mode = REPLAY_OFF;
+      finished = true;
+      return;
+    }
+    while (next < header.events && events[next].frame <= frame) {
+      keys = events[next++].keys;
+    }
+    for (int k = 0; k < 16; k++) {
+      emu->keys[k] = (keys >> k) & 1;
+    }
+    frame++;
+  }
+}
+
+void replay_timing(uint32_t us) {
+  timed++;
+  totalUs += us;
+  if (us < minUs) {
+    minUs = us;
+  }
+  if (us > maxUs) {
+    maxUs = us;
+  }
+}
+
+bool replay_finished(void) {
+  bool f = finished;
+  finished = false;
+  return f;
+}
+
+uint32_t replay_hash(const octo_emulator* emu) {
+  uint32_t h = 2166136261u;
+  for (size_t n = 0; n < sizeof(emu->px); n++) {
+    h = (h ^ emu->px[n]) * 16777619u;
+  }
+  for (size_t n = 0; n < sizeof(emu->ram); n++) {
+    h = (h ^ emu->ram[n]) * 16777619u;
+  }
+  return h;
+}
+
+size_t replay_report(const octo_emulator* emu, char* buf, size_t size) {
+  int len = snprintf(buf, size,
+    "{\"rom\":\"%s\",\"frames\":%u,\"timed\":%u,\"avgUs\":%u,\"minUs\":%u,\"maxUs\":%u,\"hash\":\"%08x\"}",
+    header.path, (unsigned)header.frames, (unsigned)timed,
+    (unsigned)(timed ? totalUs / timed : 0), (unsigned)(timed ? minUs : 0), (unsigned)maxUs,
+    (unsigned)replay_hash(emu));
+  return len < (int)size ? len : size - 1;
+}
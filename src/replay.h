@@ -0,0 +1,56 @@
+/**
+ * Deterministic input recording and replay.
+ *
+ * A session log holds the program path, the RNG seed and the key mask
+ * whenever it changes, frame by frame. Replaying it from a fresh start of
+ * the same program reproduces the run exactly and reports frame times and
+ * a hash of the final display and RAM.
+ */
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#define REPLAY_PATH_MAX 64
+
+enum replay_mode {
+  REPLAY_OFF,
+  REPLAY_RECORD,
+  REPLAY_PLAY
+};
+
+replay_mode replay_state(void);
+
+// Starts recording; the caller has just (re)loaded the program at romPath
+// and seeded the RNG with seed
+bool replay_record(const char* romPath, uint32_t seed);
+
+// Stops recording and writes the log to path
+bool replay_save(const char* path);
+
+// Reads a log for playback. The caller then loads *romPath, seeds the RNG
+// with *seed and calls replay_play().
+bool replay_load(const char* path, char* romPath, uint32_t* seed);
+void replay_play(void);
+
+void replay_stop(void);
+
+// Call at the start of each emulated frame: records the keys, or sets
+// them from the log. Ends the playback after the last recorded frame.
+void replay_input(octo_emulator* emu);
+
+// Call with the time a displayed frame took while playing back
+void replay_timing(uint32_t us);
+
+// True once after a playback finished
+bool replay_finished(void);
+
+// Writes the statistics of the last playback as JSON, returns its length
+size_t replay_report(const octo_emulator* emu, char* buf, size_t size);
+
+// FNV-1a hash of the display and RAM
+uint32_t replay_hash(const octo_emulator* emu);
+
+#endif
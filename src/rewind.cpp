@@ -0,0 +1,343 @@
+/**
+ * Rewind buffer.
+ *
+ * The state is split into pages: the registers and everything else outside
+ * ram, px, ppx and keys, the covered RAM, and the display rows. The keys
+ * are live input, rewinding leaves them as they are. A record holds
+ * the previous contents of the pages a frame changed:
+ *   length, (page number, page bytes)..., length
+ * both lengths 16 bits, so the ring can be walked from either end.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "console.h"
+#include "rewind.h"
+
+static const uint32_t PAGE = 64;
+static const uint32_t ROW = 128;              // px bytes per display row
+static const uint32_t PACKED = ROW / 4;       // 2 bits per pixel
+static const int SEGMENTS = 6;
+
+struct Segment {
+  uint32_t offset;      // in octo_emulator
+  uint32_t size;
+  uint32_t shadow;      // in shadow
+  uint16_t first;       // number of its first page
+  uint16_t pages;
+  bool packed;          // display rows
+};
+
+static Segment segs[SEGMENTS];
+static int segCount;
+static uint16_t pageCount;
+
+static uint8_t* shadow;
+static uint32_t shadowSize;
+static uint32_t* dirty;         // one bit per page
+
+// RAM not covered (if there wasn't memory for all) from scope on, and its sum
+static uint32_t scope;
+static uint32_t beyond;
+
+static uint8_t* ring;
+static uint32_t head;           // next write
+static uint32_t tail;           // oldest record
+static uint32_t used;
+static int frames;
+
+static uint32_t captures;
+static uint64_t totalUs;
+static uint32_t maxUs;
+static uint32_t lastBytes;
+
+static void addSegment(uint32_t offset, uint32_t size, bool packed) {
+  Segment* s = &segs[segCount++];
+  s->offset = offset;
+  s->size = size;
+  s->packed = packed;
+  s->shadow = shadowSize;
+  s->first = pageCount;
+  if (packed) {
+    s->pages = size / ROW;
+    shadowSize += s->pages * PACKED;
+  }
+  else {
+    s->pages = (size + PAGE - 1) / PAGE;
+    shadowSize += size;
+  }
+  pageCount += s->pages;
+}
+
+static uint32_t pageBytes(const Segment* s, uint32_t page) {
+  if (s->packed) {
+    return PACKED;
+  }
+  uint32_t left = s->size - page * PAGE;
+  return left < PAGE ? left : PAGE;
+}
+
+static uint8_t* shadowPage(const Segment* s, uint32_t page) {
+  return shadow + s->shadow + page * (s->packed ? PACKED : PAGE);
+}
+
+// The page as stored, packed into tmp for display rows
+static const uint8_t* current(const octo_emulator* emu, const Segment* s, uint32_t page, uint8_t* tmp) {
+  const uint8_t* p = (const uint8_t*)emu + s->offset;
+  if (!s->packed) {
+    return p + page * PAGE;
+  }
+  p += page * ROW;
+  for (uint32_t k = 0; k < PACKED; k++, p += 4) {
+    tmp[k] = (p[0] & 3) | (p[1] & 3) << 2 | (p[2] & 3) << 4 | (p[3] & 3) << 6;
+  }
+  return tmp;
+}
+
+static void restore(octo_emulator* emu, const Segment* s, uint32_t page, const uint8_t* data) {
+  uint8_t* p = (uint8_t*)emu + s->offset;
+  uint32_t len = pageBytes(s, page);
+  memcpy(shadowPage(s, page), data, len);
+  if (!s->packed) {
+    memcpy(p + page * PAGE, data, len);
+    return;
+  }
+  p += page * ROW;
+  for (uint32_t k = 0; k < ROW; k++) {
+    p[k] = (data[k >> 2] >> ((k & 3) * 2)) & 3;
+  }
+}
+
+static void put(const void* data, uint32_t n) {
+  uint32_t part = REWIND_BYTES - head < n ? REWIND_BYTES - head : n;
+  memcpy(ring + head, data, part);
+  memcpy(ring, (const uint8_t*)data + part, n - part);
+  head = (head + n) % REWIND_BYTES;
+  used += n;
+}
+
+static void get(uint32_t pos, void* data, uint32_t n) {
+  pos %= REWIND_BYTES;
+  uint32_t part = REWIND_BYTES - pos < n ? REWIND_BYTES - pos : n;
+  memcpy(data, ring + pos, part);
+  memcpy((uint8_t*)data + part, ring, n - part);
+}
+
+static void dropOldest(void) {
+  uint16_t len;
+  get(tail, &len, 2);
+  tail = (tail + len + 4) % REWIND_BYTES;
+  used -= len + 4;
+  frames--;
+}
+
+void rewind_stop(void) {
+  free(shadow);
+  free(dirty);
+  free(ring);
+  shadow = NULL;
+  dirty = NULL;
+  ring = NULL;
+}
+
+bool rewind_enabled(void) {
+  return ring != NULL;
+}
+
+// Sum of the RAM from scope on, to see that nothing was written there
+static uint32_t sumBeyond(const octo_emulator* emu) {
+  uint32_t sum = 0;
+  for (uint32_t at = scope; at + 4 <= sizeof(emu->ram); at += 4) {
+    uint32_t w;
+    memcpy(&w, emu->ram + at, 4);
+    sum = (sum << 1 | sum >> 31) + w;
+  }
+  return sum;
+}
+
+// Splits the state into segments, covering RAM below scope
+static void split(const octo_emulator* emu) {
+  // everything but ram, px, ppx and keys, in struct order
+  const int SKIPS = 4;
+  struct { uint32_t offset, size; } skip[SKIPS] = {
+    { offsetof(octo_emulator, ram), sizeof(emu->ram) },
+    { offsetof(octo_emulator, px), sizeof(emu->px) },
+    { offsetof(octo_emulator, ppx), sizeof(emu->ppx) },
+    { offsetof(octo_emulator, keys), sizeof(emu->keys) }
+  };
+  for (int n = 1; n < SKIPS; n++) {
+    for (int k = n; k > 0 && skip[k].offset < skip[k - 1].offset; k--) {
+      uint32_t o = skip[k].offset, z = skip[k].size;
+      skip[k] = skip[k - 1];
+      skip[k - 1].offset = o;
+      skip[k - 1].size = z;
+    }
+  }
+  segCount = 0;
+  pageCount = 0;
+  shadowSize = 0;
+  uint32_t at = 0;
+  for (int n = 0; n < SKIPS; n++) {
+    if (skip[n].offset > at) {
+      addSegment(at, skip[n].offset - at, false);
+    }
+    at = skip[n].offset + skip[n].size;
+  }
+  if (at < sizeof(octo_emulator)) {
+    addSegment(at, sizeof(octo_emulator) - at, false);
+  }
+  addSegment(offsetof(octo_emulator, ram), scope, false);
+  addSegment(offsetof(octo_emulator, px), sizeof(emu->px), true);
+}
+
+bool rewind_start(const octo_emulator* emu, uint32_t romEnd) {
+  rewind_stop();
+
+  // all RAM the program can address, else what it's likely to use
+  ring = (uint8_t*)malloc(REWIND_BYTES);
+  scope = sizeof(emu->ram);
+  split(emu);
+  shadow = (uint8_t*)malloc(shadowSize);
+  if (!shadow) {
+    scope = romEnd < 0x1000 ? 0x1000 : romEnd < sizeof(emu->ram) ? romEnd : sizeof(emu->ram);
+    split(emu);
+    shadow = (uint8_t*)malloc(shadowSize);
+  }
+  beyond = sumBeyond(emu);
+
+  dirty = (uint32_t*)malloc((pageCount + 31) / 32 * 4);
+  if (!shadow || !dirty || !ring) {
+    rewind_stop();
+    return false;
+  }
+
+  uint8_t tmp[PACKED];
+  for (int n = 0; n < segCount; n++) {
+    for (uint32_t page = 0; page < segs[n].pages; page++) {
+      memcpy(shadowPage(&segs[n], page), current(emu, &segs[n], page, tmp),
+        pageBytes(&segs[n], page));
+    }
+  }
+  head = tail = used = 0;
+  frames = 0;
+  captures = 0;
+  totalUs = 0;
+  maxUs = 0;
+  lastBytes = 0;
+  return true;
+}
+
+void rewind_capture(const octo_emulator* emu) {
+  if (!ring) {
+    return;
+  }
+  if (scope < sizeof(emu->ram) && sumBeyond(emu) != beyond) {
+    // restoring would mix in RAM from later on
+    console_printf("Rewind off, the program wrote above %04X\r\n", (unsigned)scope);
+    rewind_stop();
+    return;
+  }
+
+  // find the changed pages and the record size
+  uint8_t tmp[PACKED];
+  uint32_t size = 0;
+  memset(dirty, 0, (pageCount + 31) / 32 * 4);
+  for (int n = 0; n < segCount; n++) {
+    const Segment* s = &segs[n];
+    for (uint32_t page = 0; page < s->pages; page++) {
+      uint32_t len = pageBytes(s, page);
+      if (memcmp(current(emu, s, page, tmp), shadowPage(s, page), len) != 0) {
+        uint32_t k = s->first + page;
+        dirty[k >> 5] |= 1u << (k & 31);
+        size += 2 + len;
+      }
+    }
+  }
+  lastBytes = size + 4;
+
+  if (size + 4 > REWIND_BYTES || size > 0xFFFF) {
+    // can't be undone: forget the history, keep the shadow current
+    head = tail = used = 0;
+    frames = 0;
+  }
+  else {
+    while (REWIND_BYTES - used < size + 4) {
+      dropOldest();
+    }
+    uint16_t len = size;
+    put(&len, 2);
+  }
+
+  for (int n = 0; n < segCount; n++) {
+    const Segment* s = &segs[n];
+    for (uint32_t page = 0; page < s->pages; page++) {
+      uint16_t k = s->first + page;
+      if (!(dirty[k >> 5] >> (k & 31) & 1)) {
+        continue;
+      }
+      uint32_t len = pageBytes(s, page);
+      uint8_t* old = shadowPage(s, page);
+      if (size + 4 <= REWIND_BYTES) {
+        put(&k, 2);
+        put(old, len);
+      }
+      memcpy(old, current(emu, s, page, tmp), len);
+    }
+  }
+
+  if (size + 4 <= REWIND_BYTES) {
+    uint16_t len = size;
+    put(&len, 2);
+    frames++;
+  }
+}
+
+void rewind_timing(uint32_t us) {
+  captures++;
+  totalUs += us;
+  if (us > maxUs) {
+    maxUs = us;
+  }
+}
+
+bool rewind_step(octo_emulator* emu) {
+  if (!ring || !frames) {
+    return false;
+  }
+  uint16_t len;
+  get(head + REWIND_BYTES - 2, &len, 2);
+  uint32_t start = (head + REWIND_BYTES - 4 - len) % REWIND_BYTES;
+
+  uint8_t data[PAGE];
+  for (uint32_t at = start + 2; at < start + 2 + len; ) {
+    uint16_t k;
+    get(at, &k, 2);
+    int n = 0;
+    while (k >= segs[n].first + segs[n].pages) {
+      n++;
+    }
+    uint32_t page = k - segs[n].first;
+    uint32_t size = pageBytes(&segs[n], page);
+    get(at + 2, data, size);
+    restore(emu, &segs[n], page, data);
+    at += 2 + size;
+  }
+
+  head = start;
+  used -= len + 4;
+  frames--;
+  return true;
+}
+
+int rewind_frames(void) {
+  return frames;
+}
+
+size_t rewind_stats(char* buf, size_t size) {
+  int len = snprintf(buf, size,
+    "{\"enabled\":%s,\"frames\":%d,\"bytes\":%u,\"lastBytes\":%u,\"captures\":%u,\"avgUs\":%u,\"maxUs\":%u}",
+    ring ? "true" : "false", frames, (unsigned)used, (unsigned)lastBytes, (unsigned)captures,
+    (unsigned)(captures ? totalUs / captures : 0), (unsigned)maxUs);
+  return len < (int)size ? len : size - 1;
+}
@@ -0,0 +1,41 @@
+/**
+ * Rewind buffer: the last few seconds of emulator state, frame by frame.
+ *
+ * A shadow copy holds the state of the last captured frame. Each capture
+ * stores the shadow's parts that changed since then (64-byte RAM pages,
+ * display rows packed to 2 bits per pixel, the registers) in a ring, so
+ * stepping back undoes one frame at a time from the live state.
+ */
+#ifndef _REWIND_H
+#define _REWIND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+// Size of the ring of frame records
+#define REWIND_BYTES (32 * 1024)
+
+// Starts over from the state in emu. All of RAM is covered, or without
+// the memory for that up to the end of the program, at least the first
+// 4K; rewind then stops should the program write above. Returns false if
+// out of memory.
+bool rewind_start(const octo_emulator* emu, uint32_t romEnd);
+void rewind_stop(void);
+
+bool rewind_enabled(void);
+
+// Call at the end of each emulated frame
+void rewind_capture(const octo_emulator* emu);
+// Call with the time rewind_capture() took
+void rewind_timing(uint32_t us);
+
+// Restores the previous frame, false when the history is used up
+bool rewind_step(octo_emulator* emu);
+
+int rewind_frames(void);
+
+// Writes history and capture time statistics as JSON, returns the length
+size_t rewind_stats(char* buf, size_t size);
+
+#endif
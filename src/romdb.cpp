@@ -0,0 +1,45 @@
+/**
+ * ROM options database.
+ */
+#include "romdb.h"
+#include "romdb_table.h"
+
+static const int COUNT = sizeof(romdb_table) / sizeof(romdb_table[0]);
+
+uint32_t romdb_hash(const uint8_t* rom, int size) {
+  uint32_t h = 0x811C9DC5;
+  for (int n = 0; n < size; n++) {
+    h = (h ^ rom[n]) * 0x01000193;
+  }
+  return h;
+}
+
+bool romdb_options(const uint8_t* rom, int size, octo_options* options) {
+  octo_default_options(options);
+  uint32_t h = romdb_hash(rom, size);
+  int lo = 0, hi = COUNT - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    const romdb_entry* e = &romdb_table[mid];
+    if (e->hash < h) {
+      lo = mid + 1;
+    }
+    else
+    if (e->hash > h) {
+      hi = mid - 1;
+    }
+    else {
+      if (e->size != size) {
+        return false;
+      }
+      options->tickrate = e->tickrate;
+      for (int n = 0; n < 4; n++) {
+        options->colors[n] = e->colors[n];
+      }
+      options->q_shift = (e->quirks & ROMDB_SHIFT) != 0;
+      options->q_loadstore = (e->quirks & ROMDB_LOADSTORE) != 0;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,38 @@
+/**
+ * Options of known ROMs, so plain .ch8 files can be run: tickrate, palette
+ * and quirks from fs/chip8.txt, found by a hash of the ROM's contents in a
+ * sorted table in flash (generated by fs/romdb.py).
+ */
+#ifndef _ROMDB_H
+#define _ROMDB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#ifdef __cplusplus          // the fs/ tools are C
+extern "C" {
+#endif
+
+#define ROMDB_SHIFT 1         // quirks
+#define ROMDB_LOADSTORE 2
+
+struct romdb_entry {
+  uint32_t hash;
+  uint16_t size;
+  uint16_t tickrate;
+  uint32_t colors[4];         // background, fill 1, fill 2, blend
+  uint8_t quirks;
+};
+
+// FNV-1a over the ROM
+uint32_t romdb_hash(const uint8_t* rom, int size);
+
+// The options for rom, defaults if it's unknown. Returns false then.
+bool romdb_options(const uint8_t* rom, int size, octo_options* options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+// Generated by fs/romdb.py from fs/chip8.txt, don't edit
+static const romdb_entry romdb_table[] = {
+  { 0x0102FE62, 690, 15, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam9title
+  { 0x02B8CF23, 3340, 20, { 0xFF1F1F1F, 0xFFF0F0F0, 0xFFAA2222, 0xFF000000 }, 0 },   // DVN8
+  { 0x03835539, 595, 30, { 0xFF43523D, 0xFFC7F0D8, 0xFFFFAA00, 0xFF000000 }, 0 },   // superpong
+  { 0x041B5866, 2285, 7, { 0xFFF1F1F1, 0xFF0F0F0F, 0xFFAAFF55, 0xFF777777 }, 0 },   // 8ceattourny_d3
+  { 0x0594FA1A, 1348, 15, { 0xFFB4B4B4, 0xFF323232, 0xFFFFAA00, 0xFF000000 }, 0 },   // spockpaperscissors
+  { 0x072FA882, 3552, 1000, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // binding
+  { 0x119AA1E0, 1596, 7, { 0xFF553300, 0xFFFFFFFF, 0xFFFFAA00, 0xFFFFFFFF }, 0 },   // ultimatetictactoe
+  { 0x136AC169, 2480, 7, { 0xFFF1F1F1, 0xFF0F0F0F, 0xFFAAFF55, 0xFF777777 }, 0 },   // 8ceattourny_d1
+  { 0x145AAC34, 4713, 200, { 0xFF43523D, 0xFFC7F0D8, 0xFF43523D, 0xFF43523D }, 0 },   // ordinaryidlegarden
+  { 0x14EB0C53, 2684, 200, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // knight
+  { 0x14FA65C6, 1569, 500, { 0xFFFFFFFF, 0xFF552200, 0xFFFFFFFF, 0xFF000000 }, 0 },   // supersquare
+  { 0x15BE1390, 1784, 30, { 0xFFFF8C1F, 0xFF662200, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam7title
+  { 0x18855C71, 3512, 200, { 0xFFACD5FF, 0xFF113152, 0xFF264C74, 0xFF000000 }, 0 },   // octopeg
+  { 0x1D10000F, 56380, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-1
+  { 0x1E8D74F5, 58566, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-3
+  { 0x1EB1B0E9, 65, 1000, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // snek
+  { 0x1F17A009, 3581, 7, { 0xFFEEEEEE, 0xFF111111, 0xFFFFFF00, 0xFF222222 }, 0 },   // octoachip8story
+  { 0x1FEBAC7C, 3284, 7, { 0xFFF1F1F1, 0xFF0F0F0F, 0xFFAAFF55, 0xFF777777 }, 0 },   // octorancher
+  { 0x2073B1D9, 2270, 20, { 0xFFFCFCFC, 0xFF111111, 0xFFFFAA00, 0xFF000000 }, 0 },   // spaceracer
+  { 0x2195EAF3, 800, 20, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // chipcross
+  { 0x21D69891, 3579, 60, { 0xFFFFFFFF, 0xFF000000, 0xFFFFAA00, 0xFF111111 }, 0 },   // sub8
+  { 0x2289677F, 760, 7, { 0xFF9BBC0F, 0xFF0F380F, 0xFF333333, 0xFF000000 }, 0 },   // flutterby
+  { 0x236665FE, 2017, 7, { 0xFF220000, 0xFFAA9999, 0xFFFFAA00, 0xFF000000 }, 0 },   // RPS
+  { 0x2BD95389, 3581, 200, { 0xFFFF69B4, 0xFF000000, 0xFF111111, 0xFF000000 }, 3 },   // octogon
+  { 0x33EC3D7B, 1869, 7, { 0xFFFAFAFA, 0xFF0C0C0C, 0xFFFAFAFA, 0xFF1A1A1A }, 0 },   // petdog
+  { 0x356E9AB6, 5114, 100, { 0xFF754D27, 0xFF141421, 0xFFFFAA00, 0xFF000000 }, 0 },   // civiliz8n
+  { 0x35C05198, 2404, 1000, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // trucksimul8or
+  { 0x3810C025, 3790, 1000, { 0xFF55FF55, 0xFF000000, 0xFF000000, 0xFF000000 }, 0 },   // OctoPartyMix
+  { 0x3B451162, 346, 7, { 0xFF330033, 0xFFAAAAFF, 0xFFFFAA00, 0xFF000000 }, 0 },   // BadKaiJuJu
+  { 0x3F84F9EF, 538, 100, { 0xFF000000, 0xFFFFFFFF, 0xFF666666, 0xFF000000 }, 0 },   // wonkypong
+  { 0x40A717E6, 3220, 15, { 0xFF000000, 0xFFFFFFFF, 0xFFFFAA00, 0xFF000000 }, 0 },   // knumberknower
+  { 0x42959664, 65000, 1000, { 0xFF1A1C19, 0xFFFAFDF9, 0xFF222211, 0xFF212110 }, 0 },   // keshaWasBiird
+  { 0x42A14366, 563, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // mini-lights-out
+  { 0x43719D8D, 33005, 1000, { 0xFF554422, 0xFF87CEEB, 0xFFFFFFFF, 0xFF000000 }, 0 },   // t8nks
+  { 0x45DECAD3, 2482, 30, { 0xFF000080, 0xFFB0E0E6, 0xFFFFAA00, 0xFF000000 }, 0 },   // slipperyslope
+  { 0x466FCBF7, 3431, 200, { 0xFF443300, 0xFFAA7700, 0xFFFFAA00, 0xFF000000 }, 0 },   // eaty
+  { 0x4F93D920, 199, 7, { 0xFFFF84FE, 0xFFCA2553, 0xFFFFAA00, 0xFFF090E4 }, 0 },   // br8kout
+  { 0x4FB61316, 1890, 7, { 0xFFFFAA00, 0xFF662200, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam10title
+  { 0x58B71340, 135, 7, { 0xFFFF00FF, 0xFF00FFFF, 0xFF990099, 0xFF330033 }, 0 },   // ghostEscape
+  { 0x5B09CE7A, 1993, 200, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // tank
+  { 0x5BD9CB9F, 192, 7, { 0xFF000080, 0xFFFF69B4, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam5title
+  { 0x5E088C9C, 492, 7, { 0xFFFFFFFF, 0xFF000000, 0xFFFFAA00, 0xFF000000 }, 0 },   // tombstontipp
+  { 0x60DF03F8, 65024, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-2
+  { 0x69227770, 424, 15, { 0xFF306230, 0xFF8BAC0F, 0xFF333333, 0xFF000000 }, 0 },   // fuse
+  { 0x6F0B6271, 484, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // chip8-test-rom-with-audio
+  { 0x6FCF6352, 8947, 1000, { 0xFFE0FFFF, 0xFF001000, 0xFF333333, 0xFF000000 }, 0 },   // garlicscape
+  { 0x70257996, 31543, 1000, { 0xFF43523D, 0xFFC7F0D8, 0xFF43523D, 0xFF43523D }, 0 },   // expedition
+  { 0x73E9B977, 65000, 10000, { 0xFF000000, 0xFFB22D10, 0xFF400000, 0xFF400000 }, 0 },   // redOctober
+  { 0x76AAD711, 62376, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-5
+  { 0x78A9A7B3, 39000, 1000, { 0xFFB22D10, 0xFF283593, 0xFF182583, 0xFF182583 }, 0 },   // keshaWasNiiinja
+  { 0x7A0DFD8E, 326, 20, { 0xFFC3C3C3, 0xFF006C00, 0xFFFFAA00, 0xFF000000 }, 0 },   // horseyJump
+  { 0x7AD6E561, 3580, 100, { 0xFFB00000, 0xFF001000, 0xFFFFAA00, 0xFF000000 }, 3 },   // applejak
+  { 0x7AECB8B4, 150, 1000, { 0xFF00F80A, 0xFF274A17, 0xFFFFAA00, 0xFF142A12 }, 0 },   // 1dcell
+  { 0x84C00947, 1777, 15, { 0xFF000066, 0xFF6699FF, 0xFFFFAA00, 0xFF000000 }, 0 },   // chipwar
+  { 0x86D711DD, 1490, 100, { 0xFFFCFCFC, 0xFF111111, 0xFFFFAA00, 0xFF000000 }, 0 },   // spacejam
+  { 0x872196BC, 3166, 15, { 0xFFFF6666, 0xFF1A3674, 0xFF3B6C83, 0xFF000000 }, 0 },   // masquer8
+  { 0x8FDC3A56, 3413, 20, { 0xFF7B0201, 0xFFD4D4D4, 0xFF990099, 0xFF330033 }, 0 },   // sk8
+  { 0x932DBE8F, 3575, 20, { 0xFF1A3279, 0xFFBAD9B6, 0xFFFFF6D6, 0xFF000000 }, 3 },   // sens8tion
+  { 0x998DB672, 426, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam1title
+  { 0x9AE874CD, 3549, 120, { 0xFF5B1B96, 0xFF8BDCE8, 0xFF68E022, 0xFF000000 }, 0 },   // octovore
+  { 0x9EEB331B, 9201, 10000, { 0xFFFF00FF, 0xFF000000, 0xFF000000, 0xFF000000 }, 0 },   // octoma
+  { 0x9F9799BA, 10084, 1000, { 0xFFE6E6FA, 0xFF100010, 0xFF000000, 0xFF000000 }, 0 },   // superneatboy
+  { 0x9FE4FE01, 17024, 500, { 0xFF7C4300, 0xFFD5A08C, 0xFF3C2300, 0xFF000000 }, 0 },   // chickenScratch
+  { 0xA4971A06, 1588, 200, { 0xFFFFCC00, 0xFF0000FF, 0xFFFFFFFF, 0xFF000000 }, 0 },   // piper
+  { 0xA4A81CE6, 1374, 7, { 0xFF111122, 0xFFFFA500, 0xFFFFFF00, 0xFF222222 }, 0 },   // pumpkindressup
+  { 0xAAD964B5, 1610, 15, { 0xFF27130F, 0xFF3DBDFA, 0xFFFF6600, 0xFF000000 }, 0 },   // down8
+  { 0xABBBD3E1, 55226, 1000, { 0xFF4B636F, 0xFF121212, 0xFF000000, 0xFF000000 }, 2 },   // skyward
+  { 0xAC769FA5, 512, 15, { 0xFFAA4400, 0xFF664400, 0xFFFF7F50, 0xFF000000 }, 0 },   // outlaw
+  { 0xAC7900DB, 2144, 200, { 0xFFFFE900, 0xFFED7F37, 0xFFFFAA00, 0xFF000000 }, 0 },   // turnover77
+  { 0xADDC33F9, 1319, 1000, { 0xFF00FF00, 0xFF000000, 0xFF999900, 0xFF333300 }, 0 },   // danm8ku
+  { 0xB1991DEA, 117, 100, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // mondrian
+  { 0xB281AD84, 3299, 20, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // caveexplorer
+  { 0xB346BCF9, 2297, 15, { 0xFFFFCC00, 0xFF0000FF, 0xFFFFFFFF, 0xFF000000 }, 0 },   // carbon8
+  { 0xB7BEA623, 60000, 1000, { 0xFFB8CD9E, 0xFF59755E, 0xFF000000, 0xFF000000 }, 0 },   // keshaWasBird
+  { 0xBA0DB931, 236, 30, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // octopaint
+  { 0xC2743CD2, 2853, 20, { 0xFFFCFCFC, 0xFF005E20, 0xFFFFAA00, 0xFF000000 }, 0 },   // mastermind
+  { 0xC5089DFB, 1240, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam2title
+  { 0xC5CD56A7, 1438, 15, { 0xFF84A174, 0xFF30283E, 0xFFFFAA00, 0xFF000000 }, 0 },   // snake
+  { 0xC7A20994, 16707, 1000, { 0xFF43523D, 0xFFC7F0D8, 0xFF43523D, 0xFF43523D }, 0 },   // businessiscontagious
+  { 0xC946049B, 2535, 100, { 0xFFFF00FF, 0xFF000000, 0xFF990099, 0xFF330033 }, 2 },   // superOctoTrackXO
+  { 0xCAABBF7D, 444, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam8title
+  { 0xCB973265, 56, 1000, { 0xFFFFCC00, 0xFF996600, 0xFFFFAA00, 0xFF000000 }, 0 },   // dodge
+  { 0xCDD1273B, 2577, 500, { 0xFFFFAF00, 0xFF663300, 0xFFF9FFB3, 0xFF000000 }, 3 },   // squad
+  { 0xD209CAA4, 2591, 7, { 0xFFF1F1F1, 0xFF0F0F0F, 0xFFAAFF55, 0xFF777777 }, 0 },   // 8ceattourny_d2
+  { 0xD3CB3ABA, 23207, 500, { 0xFF000000, 0xFFFFFFFF, 0xFF808080, 0xFF000000 }, 0 },   // anEveningToDieFor
+  { 0xD42C54A8, 59904, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-4
+  { 0xD65D42E2, 1748, 15, { 0xFFFFFFFF, 0xFF0072FF, 0xFFFFAA00, 0xFF0000FF }, 0 },   // chipquarium
+  { 0xDB9ABF3E, 409, 100, { 0xFFFFFFFF, 0xFF117799, 0xFF1166DD, 0xFF000000 }, 0 },   // sweetcopter
+  { 0xDF37A71F, 295, 15, { 0xFFFFCC00, 0xFF0000FF, 0xFFFFFFFF, 0xFF000000 }, 0 },   // flightrunner
+  { 0xE204E747, 732, 30, { 0xFF783809, 0xFFA0CB6D, 0xFFFFAA00, 0xFF000000 }, 0 },   // horseWorldOnline
+  { 0xE4E472B5, 290, 30, { 0xFFC7F0D8, 0xFF43523D, 0xFF43523D, 0xFF43523D }, 0 },   // nokiatemplate
+  { 0xE7443714, 2907, 200, { 0xFFFFFFFF, 0xFF555555, 0xFFFFFFFF, 0xFF000000 }, 0 },   // glitchGhost
+  { 0xEB79EBAC, 1594, 15, { 0xFFCCCCCC, 0xFF333333, 0xFFFFFFFF, 0xFF000000 }, 0 },   // rockto
+  { 0xF0D94D9B, 478, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // test_opcode
+  { 0xF2944FB8, 3302, 20, { 0xFFD3D3D3, 0xFF808080, 0xFFFFFFFF, 0xFF000000 }, 0 },   // blackrainbow
+  { 0xFA169200, 1316, 7, { 0xFF330033, 0xFFAAAAFF, 0xFF990099, 0xFF330033 }, 0 },   // octojam6title
+  { 0xFA86D5FD, 1326, 20, { 0xFF000000, 0xFF808080, 0xFFFFAA00, 0xFF000000 }, 0 },   // gradsim
+  { 0xFB24DE10, 59273, 1000, { 0xFF000000, 0xFF353C41, 0xFF353C41, 0xFF353C41 }, 0 },   // jub8-6
+  { 0xFE310F16, 3264, 100, { 0xFF1E90FF, 0xFFF9FFB3, 0xFFF9FFB3, 0xFF000000 }, 3 },   // bulb
+  { 0xFE98675C, 472, 30, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam4title
+  { 0xFEECCCB3, 2905, 15, { 0xFF808080, 0xFFD3D3D3, 0xFFFF0000, 0xFF000000 }, 0 },   // wdl
+  { 0xFF0AD231, 402, 7, { 0xFFFFAA00, 0xFFAA4400, 0xFFFFAA00, 0xFF000000 }, 0 },   // octojam3title
+};
@@ -0,0 +1,163 @@
+/**
+ * Packed display state.
+ *
+ * Sprite rows are placed at the top of a 32-bit word and shifted across
+ * the two words they land in. A row is 128 or 64 pixels, a whole number
+ * of words, so the part past the right edge is the first word of the
+ * row again when wrapping.
+ */
+#include <string.h>
+
+#include "screen.h"
+
+#ifdef SCREEN_PACKED
+
+#define WORDS 4           // per 128 pixel row
+
+static uint32_t planes[2][64][WORDS];
+static uint32_t shown[2][64][WORDS];
+static int shownHires = -1;
+
+// 8 pixels of a plane to 8 nibbles, the first one on top
+static uint32_t spread[256];
+
+void screen_pack(const octo_emulator* emu) {
+  const int rw = emu->hires ? 128 : 64, rh = emu->hires ? 64 : 32;
+  memset(planes, 0, sizeof(planes));
+  for (int y = 0; y < rh; y++) {
+    for (int x = 0; x < rw; x++) {
+      uint8_t c = emu->px[x + y*rw];
+      uint32_t bit = 0x80000000u >> (x & 31);
+      if (c & 1) {
+        planes[0][y][x >> 5] |= bit;
+      }
+      if (c & 2) {
+        planes[1][y][x >> 5] |= bit;
+      }
+    }
+  }
+}
+
+// px[at..] follows the set bits
+static void toggle(uint8_t* px, int at, uint32_t bits, uint8_t layer) {
+  while (bits) {
+    int b = __builtin_clz(bits);
+    px[at + b] ^= layer;
+    bits &= ~(0x80000000u >> b);
+  }
+}
+
+// DXYN, with Octo's wrapping and clipping
+static void draw(octo_emulator* emu, int x, int y, int n) {
+  const int rw = emu->hires ? 128 : 64, rh = emu->hires ? 64 : 32;
+  const int x0 = emu->v[x] % rw, y0 = emu->v[y] % rh;
+  const int word = x0 >> 5, shift = x0 & 31;
+  const bool clip = emu->options.q_clip;
+  const int h = n ? n : 16;
+  int next = word + 1;
+  if (next == rw / 32) {
+    next = 0;
+  }
+  int i = emu->i;
+  uint32_t hit = 0;
+
+  for (int layer = 0; layer < 2; layer++) {
+    if (!(emu->plane & (layer + 1))) {
+      continue;
+    }
+    for (int a = 0; a < h; a++) {
+      int row = y0 + a;
+      if (row >= rh) {
+        if (clip) {
+          break;
+        }
+        row -= rh;
+      }
+      uint32_t bits = n ? (uint32_t)emu->ram[(i + a) & OCTO_RAM_MASK] << 24 :
+        (uint32_t)emu->ram[(i + a*2) & OCTO_RAM_MASK] << 24 |
+        (uint32_t)emu->ram[(i + a*2 + 1) & OCTO_RAM_MASK] << 16;
+      uint32_t left = bits >> shift;
+      uint32_t right = shift && !(clip && next == 0) ? bits << (32 - shift) : 0;
+
+      uint32_t* r = planes[layer][row];
+      hit |= (r[word] & left) | (r[next] & right);
+      r[word] ^= left;
+      r[next] ^= right;
+      toggle(emu->px, row*rw + word*32, left, layer + 1);
+      toggle(emu->px, row*rw + next*32, right, layer + 1);
+    }
+    i += n ? n : 32;
+  }
+  emu->v[0xF] = hit != 0;
+}
+
+void screen_instruction(octo_emulator* emu) {
+  const uint8_t op = emu->ram[emu->pc & OCTO_RAM_MASK];
+  const uint8_t arg = emu->ram[(emu->pc + 1) & OCTO_RAM_MASK];
+  // a key wait is the core's, which may go on to the next instruction once
+  // a key is down
+  if (emu->wait) {
+    octo_emulator_instruction(emu);
+    if (!emu->wait) {
+      screen_pack(emu);
+    }
+    return;
+  }
+  if ((op & 0xF0) == 0xD0) {
+    emu->pc += 2;
+    draw(emu, op & 0xF, arg >> 4, arg & 0xF);
+    return;
+  }
+  const int plane = emu->plane;
+  octo_emulator_instruction(emu);
+  if (op != 0x00) {
+    return;
+  }
+  if (arg == 0xE0) {
+    for (int layer = 0; layer < 2; layer++) {
+      if (plane & (layer + 1)) {
+        memset(planes[layer], 0, sizeof(planes[layer]));
+      }
+    }
+  }
+  else
+  // scrolls and resolution changes are rare, take them from px
+  if ((arg & 0xF0) == 0xC0 || (arg & 0xF0) == 0xD0 || arg == 0xFB || arg == 0xFC ||
+    arg == 0xFE || arg == 0xFF) {
+    screen_pack(emu);
+  }
+}
+
+bool screen_changed(const octo_emulator* emu) {
+  if (emu->hires == shownHires && memcmp(planes, shown, sizeof(planes)) == 0) {
+    return false;
+  }
+  memcpy(shown, planes, sizeof(shown));
+  shownHires = emu->hires;
+  return true;
+}
+
+void screen_render(const octo_emulator* emu, uint8_t* buf) {
+  if (!spread[1]) {
+    for (int b = 0; b < 256; b++) {
+      for (int j = 0; j < 8; j++) {
+        spread[b] |= (uint32_t)((b >> (7 - j)) & 1) << (28 - 4*j);
+      }
+    }
+  }
+  const int words = emu->hires ? 4 : 2, rh = emu->hires ? 64 : 32;
+  for (int y = 0; y < rh; y++) {
+    for (int k = 0; k < words; k++) {
+      uint32_t p0 = planes[0][y][k], p1 = planes[1][y][k];
+      for (int s = 24; s >= 0; s -= 8, buf += 4) {
+        uint32_t v = spread[(p0 >> s) & 0xFF] | spread[(p1 >> s) & 0xFF] << 1;
+        buf[0] = v >> 24;
+        buf[1] = v >> 16;
+        buf[2] = v >> 8;
+        buf[3] = v;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Packed display state, built with SCREEN_PACKED.
+ *
+ * Each plane is kept as 1 bit per pixel, rows of four 32-bit words with
+ * the leftmost pixel in the top bit (lores uses the first two). Sprites
+ * are drawn into it with shifted word XORs, collisions found by AND, and
+ * px follows bit by bit, so everything else still reads px. Spotting a
+ * changed frame compares words instead of 8K of px, and the renderer
+ * expands them straight into the 4 bit sprite.
+ */
+#ifndef _SCREEN_H
+#define _SCREEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#ifdef SCREEN_PACKED
+
+#ifdef __cplusplus          // fs/golden is C
+extern "C" {
+#endif
+
+// Rebuilds the planes from px, after anything but screen_instruction()
+// changed it: a load, a snapshot, rewind
+void screen_pack(const octo_emulator* emu);
+
+// Runs one instruction like octo_emulator_instruction(), drawing sprites
+// itself
+void screen_instruction(octo_emulator* emu);
+
+// True if the display differs from the last time it returned true
+bool screen_changed(const octo_emulator* emu);
+
+// Writes the display to a 4 bit per pixel buffer of 128x64 or 64x32
+void screen_render(const octo_emulator* emu, uint8_t* buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+static inline void screen_pack(const octo_emulator* emu) {
+}
+
+static inline void screen_instruction(octo_emulator* emu) {
+  octo_emulator_instruction(emu);
+}
+
+#endif
+
+#endif
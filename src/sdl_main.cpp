@@ -1,17 +1,73 @@
 #include <lgfx/v1/platforms/sdl/Panel_sdl.hpp>
 #if defined ( SDL_h_ )
 
+#include "console.h"
+#include "touch.h"
+
 void setup(void);
 void loop(void);
+long loopIdle(void);
+unsigned long loopTicks(void);
+
+/**
+ * The frame pacer: loop() is only called when it has something to do,
+ * in between the thread waits for the deadline or an input event.
+ * With ESPOCTO_UNCAPPED it runs flat out and reports the frame rate.
+ */
+
+static SDL_mutex* wakeLock;
+static SDL_cond* wake;
+static bool woken;            // an event came since the last wait
+
+// Called from the event thread as events are queued
+static int SDLCALL onEvent(void*, SDL_Event* event)
+{
+  switch (event->type) {
+    case SDL_MOUSEMOTION:
+      // followed while touched anyway
+      return 0;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_FINGERDOWN:
+      touch_notify();
+      break;
+  }
+  SDL_LockMutex(wakeLock);
+  woken = true;
+  SDL_CondSignal(wake);
+  SDL_UnlockMutex(wakeLock);
+  return 0;
+}
 
 __attribute__((weak))
 int user_func(bool* running)
 {
+  wakeLock = SDL_CreateMutex();
+  wake = SDL_CreateCond();
+  SDL_AddEventWatch(onEvent, NULL);
+
   setup();
+
+  const bool uncapped = getenv("ESPOCTO_UNCAPPED") != NULL;
+  Uint32 reportAt = SDL_GetTicks() + 1000;
+  unsigned long ticks = loopTicks();
   do
   {
     loop();
+    long idle = loopIdle();
+    SDL_LockMutex(wakeLock);
+    if (idle > 0 && !woken) {
+      SDL_CondWaitTimeout(wake, wakeLock, idle);
+    }
+    woken = false;
+    SDL_UnlockMutex(wakeLock);
+    if (uncapped && SDL_TICKS_PASSED(SDL_GetTicks(), reportAt)) {
+      console_printf("%lu fps\r\n", loopTicks() - ticks);
+      ticks = loopTicks();
+      reportAt += 1000;
+    }
   } while (*running);
+
+  SDL_DelEventWatch(onEvent, NULL);
   return 0;
 }
 
@@ -20,4 +76,4 @@ int main(int, char**)
   return lgfx::Panel_sdl::main(user_func);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,244 @@
+/**
+ * Emulator snapshots.
+ *
+ * File format (little endian): Header, then the octo_emulator bytes XORed
+ * with the reference (the ROM image at ram[0x200], zeros elsewhere) as
+ * tokens:
+ *   0x00-0x7F  n + 1 literal bytes follow
+ *   0x80-0xFF  followed by one byte: ((token & 0x7F) << 8 | byte) + 1 zeros
+ * The emulator struct holds no pointers, so its bytes are the full state.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef TARGET_NATIVE
+# include <SPIFFS.h>
+#endif
+
+#include "snapshot.h"
+
+struct Header {
+  uint32_t magic;
+  uint32_t structSize;    // sizeof(octo_emulator) of the writer
+  uint32_t romSize;
+  char path[SNAPSHOT_PATH_MAX];
+};
+
+static const uint32_t MAGIC = 0x504E5345;  // "ESNP"
+static const size_t ROM_OFFSET = offsetof(octo_emulator, ram) + 0x200;
+
+#ifdef TARGET_NATIVE
+typedef FILE* Handle;
+
+static Handle openFile(const char* path, bool write) {
+  return fopen(path, write ? "wb" : "rb");
+}
+
+static size_t writeFile(Handle f, const uint8_t* data, size_t size) {
+  return fwrite(data, 1, size, f);
+}
+
+static size_t readFile(Handle f, uint8_t* data, size_t size) {
+  return fread(data, 1, size, f);
+}
+
+static void closeFile(Handle f) {
+  fclose(f);
+}
+#else
+typedef File Handle;
+
+static Handle openFile(const char* path, bool write) {
+  return SPIFFS.open(path, write ? FILE_WRITE : FILE_READ);
+}
+
+static size_t writeFile(Handle f, const uint8_t* data, size_t size) {
+  return f.write(data, size);
+}
+
+static size_t readFile(Handle f, uint8_t* data, size_t size) {
+  return f.read(data, size);
+}
+
+static void closeFile(Handle f) {
+  f.close();
+}
+#endif
+
+// State bytes XORed with the reference
+struct Delta {
+  const uint8_t* state;
+  const uint8_t* rom;
+  int romSize;
+
+  uint8_t operator[](size_t k) const {
+    uint8_t b = state[k];
+    if (k >= ROM_OFFSET && k < ROM_OFFSET + romSize) {
+      b ^= rom[k - ROM_OFFSET];
+    }
+    return b;
+  }
+};
+
+// Buffers the output, ok turns false on the first failed write
+struct Writer {
+  Handle f;
+  uint8_t buf[256];
+  size_t n;
+  bool ok;
+
+  void put(uint8_t b) {
+    buf[n++] = b;
+    if (n == sizeof(buf)) {
+      flush();
+    }
+  }
+
+  void flush(void) {
+    ok = ok && writeFile(f, buf, n) == n;
+    n = 0;
+  }
+};
+
+bool snapshot_save(const octo_emulator* emu, const char* romPath,
+  const uint8_t* rom, int romSize, const char* path) {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = MAGIC;
+  header.structSize = sizeof(octo_emulator);
+  header.romSize = romSize;
+  strncpy(header.path, romPath, SNAPSHOT_PATH_MAX - 1);
+
+  Writer out;
+  out.f = openFile(path, true);
+  if (!out.f) {
+    return false;
+  }
+  out.n = 0;
+  out.ok = writeFile(out.f, (const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+  Delta d = { (const uint8_t*)emu, rom, romSize };
+  const size_t size = sizeof(octo_emulator);
+  size_t k = 0;
+
+  while (k < size && out.ok) {
+    size_t z = k;
+    while (z < size && z - k < 0x8000 && d[z] == 0) {
+      z++;
+    }
+    if (z - k >= 3 || (z > k && z == size)) {
+      size_t len = z - k - 1;
+      out.put(0x80 | (len >> 8));
+      out.put(len & 0xFF);
+      k = z;
+      continue;
+    }
+
+    // literals up to the next run of three zeros
+    size_t l = k;
+    while (l < size && l - k < 0x80 &&
+      !(d[l] == 0 && l + 2 < size && d[l + 1] == 0 && d[l + 2] == 0)) {
+      l++;
+    }
+    out.put(l - k - 1);
+    for (; k < l; k++) {
+      out.put(d[k]);
+    }
+  }
+  out.flush();
+  closeFile(out.f);
+  return out.ok;
+}
+
+static bool readHeader(Handle f, Header* header) {
+  return readFile(f, (uint8_t*)header, sizeof(Header)) == sizeof(Header) &&
+    header->magic == MAGIC && header->structSize == sizeof(octo_emulator);
+}
+
+bool snapshot_peek(const char* path, char* romPath, int* romSize) {
+  Handle f = openFile(path, false);
+  if (!f) {
+    return false;
+  }
+  Header header;
+  bool ok = readHeader(f, &header);
+  closeFile(f);
+  if (ok) {
+    header.path[SNAPSHOT_PATH_MAX - 1] = '\0';
+    strcpy(romPath, header.path);
+    *romSize = header.romSize;
+  }
+  return ok;
+}
+
+bool snapshot_load(octo_emulator* emu, const uint8_t* rom, int romSize, const char* path) {
+  Handle f = openFile(path, false);
+  if (!f) {
+    return false;
+  }
+  Header header;
+  if (!readHeader(f, &header) || (int)header.romSize != romSize) {
+    closeFile(f);
+    return false;
+  }
+
+  uint8_t* state = (uint8_t*)emu;
+  const size_t size = sizeof(octo_emulator);
+  uint8_t buf[256];
+  size_t have = 0, pos = 0, k = 0;
+  bool ok = true;
+
+  // next input byte, refilling buf as needed
+  auto next = [&](uint8_t* b) -> bool {
+    if (pos == have) {
+      have = readFile(f, buf, sizeof(buf));
+      pos = 0;
+      if (!have) {
+        return false;
+      }
+    }
+    *b = buf[pos++];
+    return true;
+  };
+
+  while (k < size && ok) {
+    uint8_t token, b;
+    ok = next(&token);
+    if (!ok) {
+      break;
+    }
+    if (token & 0x80) {
+      ok = next(&b);
+      size_t len = (((token & 0x7F) << 8) | b) + 1;
+      ok = ok && k + len <= size;
+      if (ok) {
+        memset(state + k, 0, len);
+        k += len;
+      }
+    }
+    else {
+      for (int n = 0; n <= token && ok; n++) {
+        ok = next(&b) && k < size;
+        if (ok) {
+          state[k++] = b;
+        }
+      }
+    }
+  }
+  closeFile(f);
+
+  // undo the delta against the ROM image
+  for (int n = 0; ok && n < romSize; n++) {
+    state[ROM_OFFSET + n] ^= rom[n];
+  }
+  return ok && k == size;
+}
+
+void snapshot_remove(const char* path) {
+#ifdef TARGET_NATIVE
+  remove(path);
+#else
+  SPIFFS.remove(path);
+#endif
+}
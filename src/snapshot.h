@@ -0,0 +1,28 @@
+/**
+ * Emulator snapshots: the complete octo_emulator (RAM, registers, stack,
+ * timers, px, options) stored as a run-length encoded delta against the
+ * ROM image, so an untouched program costs only a few bytes beyond the
+ * registers and the display.
+ */
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdint.h>
+#include <octo_emulator.h>
+
+#define SNAPSHOT_PATH_MAX 64
+
+// rom/romSize is the program image the delta is taken against (loaded at 0x200)
+bool snapshot_save(const octo_emulator* emu, const char* romPath,
+  const uint8_t* rom, int romSize, const char* path);
+
+// Reads the program path and size a snapshot belongs to, false if there
+// is no usable snapshot at path
+bool snapshot_peek(const char* path, char* romPath, int* romSize);
+
+// Restores emu; rom must be the image of the program returned by snapshot_peek()
+bool snapshot_load(octo_emulator* emu, const uint8_t* rom, int romSize, const char* path);
+
+void snapshot_remove(const char* path);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * Off-screen text lines.
+ *
+ * The line is a 1 bit per pixel sprite, rows (w + 7) / 8 bytes with the
+ * leftmost pixel in the top bit. Atlas glyphs are stored the same way,
+ * one byte per row, for the printable ASCII characters.
+ *
+ * Without the memory for the line, the strings put are kept and drawn
+ * straight to the display by text_push(), like before there were lines.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "text.h"
+
+struct Atlas {
+  const lgfx::IFont* font;
+  uint8_t w, h;
+  uint8_t* rows;      // 95 glyphs of h rows
+};
+
+static Atlas atlas[2] = {
+  { &fonts::Font0, 6, 8, NULL },
+  { &fonts::AsciiFont8x16, 8, 16, NULL }
+};
+
+static lgfx::LovyanGFX* target;
+static LGFX_Sprite* line;
+static int lineW, lineH;
+
+#define PUTS_MAX 8
+#define PUT_TEXT (TEXT_WIDTH / 6 + 1)
+
+struct Put {
+  text_font f;
+  int16_t x, y;
+  bool inverted;
+  char s[PUT_TEXT];
+};
+
+static Put pending[PUTS_MAX];
+static int pendingCount;
+
+static bool render(Atlas* a) {
+  a->rows = (uint8_t*)calloc(95, a->h);
+  if (!a->rows) {
+    return false;
+  }
+  LGFX_Sprite glyph;
+  glyph.setColorDepth(1);
+  if (!glyph.createSprite(a->w, a->h)) {
+    free(a->rows);
+    a->rows = NULL;
+    return false;
+  }
+  glyph.setTextColor(1, 0);
+  for (int c = 0; c < 95; c++) {
+    glyph.fillScreen(0);
+    glyph.drawChar(' ' + c, 0, 0, a->font);
+    for (int y = 0; y < a->h; y++) {
+      uint8_t bits = 0;
+      for (int x = 0; x < a->w; x++) {
+        if (glyph.readPixelValue(x, y)) {
+          bits |= 0x80 >> x;
+        }
+      }
+      a->rows[c * a->h + y] = bits;
+    }
+  }
+  glyph.deleteSprite();
+  return true;
+}
+
+bool text_init(lgfx::LovyanGFX* lcd) {
+  target = lcd;
+  line = new LGFX_Sprite(lcd);
+  line->setColorDepth(1);
+  if (!line->createSprite(TEXT_WIDTH, TEXT_HEIGHT)) {
+    delete line;
+    line = NULL;
+    return false;
+  }
+  return render(&atlas[TEXT_SMALL]) && render(&atlas[TEXT_LARGE]);
+}
+
+LGFX_Sprite* text_begin(int w, int h) {
+  lineW = w;
+  lineH = h;
+  pendingCount = 0;
+  if (!line) {
+    return NULL;
+  }
+  line->fillScreen(0);
+  line->setTextColor(1, 0);
+  return line;
+}
+
+void text_put(text_font f, int x, int y, const char* s, bool inverted) {
+  const Atlas* a = &atlas[f];
+  if (!line) {
+    if (pendingCount < PUTS_MAX) {
+      Put* p = &pending[pendingCount++];
+      p->f = f;
+      p->x = x;
+      p->y = y;
+      p->inverted = inverted;
+      strncpy(p->s, s, PUT_TEXT - 1);
+      p->s[PUT_TEXT - 1] = '\0';
+    }
+    return;
+  }
+  if (!a->rows) {
+    line->setTextColor(inverted ? 0 : 1, inverted ? 1 : 0);
+    line->drawString(s, x, y, a->font);
+    line->setTextColor(1, 0);
+    return;
+  }
+  uint8_t* buf = (uint8_t*)line->getBuffer();
+  const int stride = (TEXT_WIDTH + 7) / 8;
+  const uint16_t mask = (uint16_t)(0xFF00 << (8 - a->w));
+
+  for (; *s && x + a->w <= lineW; s++, x += a->w) {
+    int c = (uint8_t)*s - ' ';
+    if (c < 0 || c >= 95) {
+      c = '?' - ' ';
+    }
+    const uint8_t* g = a->rows + c * a->h;
+    uint16_t m = mask >> (x & 7);
+
+    for (int r = 0; r < a->h && y + r < lineH; r++) {
+      uint8_t glyph = inverted ? ~g[r] : g[r];
+      uint16_t bits = (glyph << 8 >> (x & 7)) & m;
+      uint8_t* p = buf + (y + r) * stride + (x >> 3);
+      p[0] = (p[0] & ~(m >> 8)) | (bits >> 8);
+      if (m & 0xFF) {
+        p[1] = (p[1] & ~m) | bits;
+      }
+    }
+  }
+}
+
+void text_push(int x, int y, uint32_t fg, uint32_t bg) {
+  if (!line) {
+    target->fillRect(x, y, lineW, lineH, bg);
+    for (int n = 0; n < pendingCount; n++) {
+      const Put* p = &pending[n];
+      target->setTextColor(p->inverted ? bg : fg, p->inverted ? fg : bg);
+      target->drawString(p->s, x + p->x, y + p->y, atlas[p->f].font);
+    }
+    pendingCount = 0;
+    return;
+  }
+  line->setPaletteColor(0, bg);
+  line->setPaletteColor(1, fg);
+  target->setClipRect(x, y, lineW, lineH);
+  line->pushSprite(x, y);
+  target->clearClipRect();
+}
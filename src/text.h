@@ -0,0 +1,35 @@
+/**
+ * Text lines composed off-screen: the fixed fonts of the monitor are copied
+ * from glyph atlases rendered once at start, other text is drawn into the
+ * line. A finished line goes to the display as a single block.
+ */
+#ifndef _TEXT_H
+#define _TEXT_H
+
+#define LGFX_USE_V1
+#include <LovyanGFX.hpp>
+
+// Largest line
+#define TEXT_WIDTH 240
+#define TEXT_HEIGHT 18
+
+enum text_font {
+  TEXT_SMALL,     // Font0, 6x8
+  TEXT_LARGE      // AsciiFont8x16
+};
+
+// Renders the atlases, false if out of memory
+bool text_init(lgfx::LovyanGFX* lcd);
+
+// Starts a w x h line in the background colour. Draw into the returned
+// sprite with palette index 1; it's NULL if text_init() failed, text_put()
+// and text_push() then draw on the display directly.
+LGFX_Sprite* text_begin(int w, int h);
+
+// Copies s in font f to (x, y) of the line, inverted swaps the colours
+void text_put(text_font f, int x, int y, const char* s, bool inverted = false);
+
+// Sends the line to (x, y)
+void text_push(int x, int y, uint32_t fg, uint32_t bg);
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Thumbnail pack.
+ *
+ * File format (little endian): "ETHM", uint16 count, uint8 width, uint8
+ * height, then count records of a NUL padded 32-byte name and the bits,
+ * sorted by name. A lookup is a binary search reading only names.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#ifndef TARGET_NATIVE
+# include <SPIFFS.h>
+#endif
+
+#include "thumbs.h"
+
+#define NAME 32
+
+static const uint32_t MAGIC = 0x4D485445;  // "ETHM"
+static const size_t HEADER = 8;
+static const size_t RECORD = NAME + THUMB_BYTES;
+
+#ifdef TARGET_NATIVE
+typedef FILE* Handle;
+
+static Handle openFile(const char* path) {
+  return fopen(path, "rb");
+}
+
+static bool readAt(Handle f, size_t pos, uint8_t* data, size_t size) {
+  return fseek(f, pos, SEEK_SET) == 0 && fread(data, 1, size, f) == size;
+}
+
+static void closeFile(Handle f) {
+  fclose(f);
+}
+
+static bool isOpen(Handle f) {
+  return f != NULL;
+}
+#else
+typedef File Handle;
+
+static Handle openFile(const char* path) {
+  return SPIFFS.open(path, FILE_READ);
+}
+
+static bool readAt(Handle f, size_t pos, uint8_t* data, size_t size) {
+  return f.seek(pos) && f.read(data, size) == size;
+}
+
+static void closeFile(Handle f) {
+  f.close();
+}
+
+static bool isOpen(Handle f) {
+  return (bool)f;
+}
+#endif
+
+static Handle pack;
+static bool opened;
+static uint16_t count;
+
+bool thumbs_open(const char* path) {
+  thumbs_close();
+  pack = openFile(path);
+  if (!isOpen(pack)) {
+    return false;
+  }
+  uint8_t h[HEADER] = { 0 };
+  uint32_t magic;
+  bool ok = readAt(pack, 0, h, sizeof(h));
+  memcpy(&magic, h, sizeof(magic));
+  if (!ok || magic != MAGIC || h[6] != THUMB_WIDTH || h[7] != THUMB_HEIGHT) {
+    closeFile(pack);
+    return false;
+  }
+  count = h[4] | h[5] << 8;
+  opened = true;
+  return true;
+}
+
+void thumbs_close(void) {
+  if (opened) {
+    closeFile(pack);
+    opened = false;
+  }
+}
+
+bool thumbs_find(const char* name, thumb_bits bits) {
+  if (!opened) {
+    return false;
+  }
+  // fs/thumbs keeps NAME - 1 characters of a name
+  char key[NAME];
+  strncpy(key, name, NAME - 1);
+  key[NAME - 1] = '\0';
+  int lo = 0, hi = count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    char entry[NAME];
+    if (!readAt(pack, HEADER + mid * RECORD, (uint8_t*)entry, NAME)) {
+      return false;
+    }
+    int c = strncmp(key, entry, NAME);
+    if (c == 0) {
+      return readAt(pack, HEADER + mid * RECORD + NAME, bits, THUMB_BYTES);
+    }
+    if (c < 0) {
+      hi = mid - 1;
+    }
+    else {
+      lo = mid + 1;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,24 @@
+/**
+ * Previews for the program browser, looked up in the thumbnail pack made
+ * by fs/thumbs: 64x32 pixels at 1 bit per pixel, by program name.
+ */
+#ifndef _THUMBS_H
+#define _THUMBS_H
+
+#include <stdint.h>
+
+#define THUMB_WIDTH 64
+#define THUMB_HEIGHT 32
+#define THUMB_BYTES (THUMB_WIDTH * THUMB_HEIGHT / 8)
+
+// Rows of 8 bytes, the leftmost pixel in the top bit
+typedef uint8_t thumb_bits[THUMB_BYTES];
+
+// Opens the pack at path, false if there is none
+bool thumbs_open(const char* path);
+void thumbs_close(void);
+
+// Reads the thumbnail of name (without the extension), false if it's missing
+bool thumbs_find(const char* name, thumb_bits bits);
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * Interrupt driven touch input.
+ */
+#ifndef TARGET_NATIVE
+# include <Arduino.h>
+#endif
+
+#include "idle.h"
+#include "touch.h"
+
+static int irqPin = -1;           // -1 polls
+static bool notified;             // touch_notify() instead of polling
+static volatile bool pending;     // pen-down edge since the last read
+static bool light;                // pen down, but too light for a position
+
+static bool down;
+static uint16_t downX, downY;
+static uint32_t lastRead;
+static uint32_t upSince;          // first untouched read while down, 0 if none
+
+static touch_event queue[TOUCH_QUEUE];
+static uint8_t head, count;
+
+#ifndef TARGET_NATIVE
+static void IRAM_ATTR penDown(void) {
+  pending = true;
+  idle_wake_isr();
+}
+#endif
+
+void touch_init(int pin) {
+  notified = pin == TOUCH_NOTIFIED;
+#ifndef TARGET_NATIVE
+  if (pin >= 0) {
+    pinMode(pin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(pin), penDown, FALLING);
+    irqPin = pin;
+    // already touched at boot
+    pending = digitalRead(pin) == LOW;
+  }
+#endif
+}
+
+void touch_notify(void) {
+  pending = true;
+}
+
+// Read every TOUCH_PERIOD rather than on pen-down
+static bool polling(void) {
+  return (irqPin < 0 && !notified) || down || light;
+}
+
+bool touch_due(uint32_t now) {
+  if (polling()) {
+    return now - lastRead >= TOUCH_PERIOD;
+  }
+  return pending;
+}
+
+uint32_t touch_idle(uint32_t now) {
+  if (pending) {
+    return 0;
+  }
+  if (polling()) {
+    uint32_t since = now - lastRead;
+    return since >= TOUCH_PERIOD ? 0 : TOUCH_PERIOD - since;
+  }
+  return UINT32_MAX;
+}
+
+static void push(touch_kind kind, uint16_t x, uint16_t y, uint32_t us) {
+  if (count == TOUCH_QUEUE) {
+    // drop the oldest, the latest state matters more
+    head = (head + 1) % TOUCH_QUEUE;
+    count--;
+  }
+  touch_event* e = &queue[(head + count) % TOUCH_QUEUE];
+  e->kind = kind;
+  e->x = x;
+  e->y = y;
+  e->us = us;
+  count++;
+}
+
+void touch_sample(bool touched, uint16_t x, uint16_t y, uint32_t now) {
+#ifndef TARGET_NATIVE
+  light = !touched && irqPin >= 0 && digitalRead(irqPin) == LOW;
+#else
+  // the notification can come before the panel sees the press, look again
+  light = !touched && notified && pending;
+#endif
+  // reading the panel toggles PENIRQ, edges until now are our own
+  pending = false;
+  lastRead = now;
+
+  if (touched) {
+    upSince = 0;
+    downX = x;
+    downY = y;
+    if (!down) {
+      down = true;
+      push(TOUCH_PRESS, x, y, now);
+    }
+  }
+  else
+  if (down) {
+    if (!upSince) {
+      upSince = now | 1;
+    }
+    else
+    if (now - upSince >= TOUCH_DEBOUNCE) {
+      down = false;
+      upSince = 0;
+      push(TOUCH_RELEASE, downX, downY, now);
+    }
+  }
+}
+
+bool touch_next(touch_event* e) {
+  if (!count) {
+    return false;
+  }
+  *e = queue[head];
+  head = (head + 1) % TOUCH_QUEUE;
+  count--;
+  return true;
+}
+
+bool touch_down(uint16_t* x, uint16_t* y) {
+  *x = downX;
+  *y = downY;
+  return down;
+}
@@ -0,0 +1,53 @@
+/**
+ * Interrupt driven touch input.
+ *
+ * The pen-down interrupt (XPT2046 PENIRQ) tells when the panel is worth
+ * reading; it's only read then and, while touched, every TOUCH_PERIOD.
+ * Samples are debounced into timestamped press and release events.
+ * Without an interrupt line the panel is polled every TOUCH_PERIOD, the
+ * simulator signals pen-down with touch_notify() instead.
+ */
+#ifndef _TOUCH_H
+#define _TOUCH_H
+
+#include <stdint.h>
+
+#define TOUCH_PERIOD 10000    // us between reads while touched
+#define TOUCH_DEBOUNCE 30000  // us untouched before a release counts
+#define TOUCH_QUEUE 8
+
+#define TOUCH_NOTIFIED -2     // touch_init() pin: pen-down from touch_notify()
+
+enum touch_kind {
+  TOUCH_PRESS,
+  TOUCH_RELEASE
+};
+
+struct touch_event {
+  touch_kind kind;
+  uint16_t x, y;
+  uint32_t us;        // micros() of the sample
+};
+
+// pin < 0 polls
+void touch_init(int pin);
+
+// Pen-down from outside, with TOUCH_NOTIFIED
+void touch_notify(void);
+
+// True if the panel should be read at now
+bool touch_due(uint32_t now);
+
+// us from now until touch_due(), UINT32_MAX if it waits for pen-down
+uint32_t touch_idle(uint32_t now);
+
+// Feeds the result of reading the panel at now
+void touch_sample(bool touched, uint16_t x, uint16_t y, uint32_t now);
+
+// Takes the oldest event, false if there is none
+bool touch_next(touch_event* e);
+
+// The debounced state and its last position
+bool touch_down(uint16_t* x, uint16_t* y);
+
+#endif